@@ -20,8 +20,13 @@
  * Author: Rob Staudinger <robsta@linux.intel.com>
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
 
 #include <gtk/gtk.h>
 
@@ -41,6 +46,54 @@ print_entry (char const *executable,
   printf ("%s\t%s\t%i\n", executable, str, n_launches);
 }
 
+/*
+ * Writers and readers serialise on the journal, so that is what we lock.
+ * Returns the locked fd, or -1.
+ */
+static int
+lock_journal (MplAppLaunchesStore *store,
+              int                  operation)
+{
+  char  *database_file = NULL;
+  char  *journal_file;
+  int    fd;
+
+  g_object_get (store, "database-file", &database_file, NULL);
+  journal_file = g_strconcat (database_file, ".journal", NULL);
+  g_free (database_file);
+
+  fd = open (journal_file, O_RDWR | O_CREAT, 0644);
+  if (-1 == fd)
+  {
+    g_warning ("%s\n\t%s : %s", G_STRLOC, journal_file, strerror (errno));
+  } else if (-1 == flock (fd, operation)) {
+    g_warning ("%s\n\t%s : %s", G_STRLOC, journal_file, strerror (errno));
+    close (fd);
+    fd = -1;
+  }
+
+  g_free (journal_file);
+  return fd;
+}
+
+static void
+lock_and_wait (MplAppLaunchesStore *store,
+               int                  operation)
+{
+  int fd;
+
+  fd = lock_journal (store, operation);
+  if (-1 == fd)
+    return;
+
+  puts ("Lock acquired, press <enter> to continue");
+  getchar ();
+
+  flock (fd, LOCK_UN);
+  close (fd);
+  puts ("Lock lifted");
+}
+
 static void
 _store_changed_cb (MplAppLaunchesStore  *store,
                    void                 *data)
@@ -61,6 +114,8 @@ main (int     argc,
   bool lock_shared = false;
   bool watch = false;
   bool dump = false;
+  int  most_recent = 0;
+  int  most_frequent = 0;
   GOptionEntry _options[] = {
     { "add", 'a', 0, G_OPTION_ARG_STRING, (void **) &add,
       "Add launch of <executable> at current time to database", "<executable>" },
@@ -73,13 +128,17 @@ main (int     argc,
     { G_OPTION_REMAINING, 'q', 0, G_OPTION_ARG_STRING_ARRAY, (void **) &query,
       "Lookup <executable> ... in database", "<executable> ..." },
     { "lock-exclusive", 'e', 0, G_OPTION_ARG_NONE, &lock_exclusive,
-      "Write-lock database", NULL },
+      "Write-lock database, blocking readers and writers", NULL },
     { "lock-shared", 's', 0, G_OPTION_ARG_NONE, &lock_shared,
-      "Read-lock database", NULL },
+      "Read-lock database, blocking writers", NULL },
     { "watch", 'w', 0, G_OPTION_ARG_NONE, &watch,
       "Watch database for changes", NULL },
     { "dump", 'd', 0, G_OPTION_ARG_NONE, &dump,
       "Dump database", NULL },
+    { "most-recent", 'r', 0, G_OPTION_ARG_INT, &most_recent,
+      "List <n> most recently launched executables", "<n>" },
+    { "most-frequent", 'f', 0, G_OPTION_ARG_INT, &most_frequent,
+      "List <n> most frequently launched executables", "<n>" },
     { NULL }
   };
 
@@ -148,40 +207,56 @@ main (int     argc,
     }
   } else if (query) {
 
-    MplAppLaunchesQuery *store_query = mpl_app_launches_store_create_query (store);
-
-    while (*query)
+    MplAppLaunchesQuery   *store_query = mpl_app_launches_store_create_query (store);
+    MplAppLaunchesResult  *results;
+    unsigned               n_executables = g_strv_length ((char **) query);
+    unsigned               i;
+    GError                *error = NULL;
+
+    results = g_new0 (MplAppLaunchesResult, n_executables);
+    mpl_app_launches_query_lookup_many (store_query,
+                                        query,
+                                        n_executables,
+                                        results,
+                                        NULL,
+                                        &error);
+    if (error)
     {
-      time_t last_launched;
-      uint32_t n_launches;
-      GError *error = NULL;
-      bool ret;
-      ret = mpl_app_launches_query_lookup (store_query,
-                                           *query,
-                                           &last_launched,
-                                           &n_launches,
-                                           &error);
-      if (ret)
-      {
-        print_entry (*query, last_launched, n_launches);
+      g_warning ("%s\n\t%s", G_STRLOC, error->message);
+      g_clear_error (&error);
 
-      } else if (error) {
+    } else {
 
-        g_warning ("%s\n\t%s", G_STRLOC, error->message);
-        g_clear_error (&error);
+      for (i = 0; i < n_executables; i++)
+      {
+        if (results[i].n_launches > 0)
+          print_entry (results[i].executable,
+                       results[i].last_launched,
+                       results[i].n_launches);
       }
-      query++;
     }
 
+    g_free (results);
     g_object_unref (store_query);
 
-  } else if (lock_exclusive) {
-
-    GError *error = NULL;
-    puts ("Write-locking database.\n"
-          "This will block if a write-lock is already in place.");
-
-    mpl_app_launches_store_open (store, true, &error);
+  } else if (most_recent > 0 || most_frequent > 0) {
+
+    MplAppLaunchesQuery   *store_query = mpl_app_launches_store_create_query (store);
+    MplAppLaunchesResult  *results;
+    unsigned               n_results;
+    unsigned               i;
+    GError                *error = NULL;
+
+    n_results = most_recent > 0 ? most_recent : most_frequent;
+    results = g_new0 (MplAppLaunchesResult, n_results);
+    mpl_app_launches_query_get_top (store_query,
+                                    most_recent > 0 ?
+                                      MPL_APP_LAUNCHES_QUERY_MOST_RECENT :
+                                      MPL_APP_LAUNCHES_QUERY_MOST_FREQUENT,
+                                    n_results,
+                                    results,
+                                    &n_results,
+                                    &error);
     if (error)
     {
       g_warning ("%s\n\t%s", G_STRLOC, error->message);
@@ -189,45 +264,28 @@ main (int     argc,
 
     } else {
 
-      puts ("Lock acquired, press <enter> to continue");
-      getchar ();
-
-      mpl_app_launches_store_close (store, &error);
-      if (error)
+      for (i = 0; i < n_results; i++)
       {
-        g_warning ("%s\n\t%s", G_STRLOC, error->message);
-        g_clear_error (&error);
-      } else {
-        puts ("Lock lifted");
+        char *hash = g_strdup_printf ("%08x", results[i].hash);
+        print_entry (hash, results[i].last_launched, results[i].n_launches);
+        g_free (hash);
       }
     }
 
-  } else if (lock_shared) {
-
-    GError *error = NULL;
-    puts ("Read-locking database.\n"
-          "This will block if a write-lock is already in place.");
+    g_free (results);
+    g_object_unref (store_query);
 
-    mpl_app_launches_store_open (store, false, &error);
-    if (error)
-    {
-      g_warning ("%s\n\t%s", G_STRLOC, error->message);
-      g_clear_error (&error);
+  } else if (lock_exclusive) {
 
-    } else {
+    puts ("Write-locking database.\n"
+          "This will block if a lock is already in place.");
+    lock_and_wait (store, LOCK_EX);
 
-      puts ("Lock acquired, press <enter> to continue");
-      getchar ();
+  } else if (lock_shared) {
 
-      mpl_app_launches_store_close (store, &error);
-      if (error)
-      {
-        g_warning ("%s\n\t%s", G_STRLOC, error->message);
-        g_clear_error (&error);
-      } else {
-        puts ("Lock lifted");
-      }
-    }
+    puts ("Read-locking database.\n"
+          "This will block if a write-lock is already in place.");
+    lock_and_wait (store, LOCK_SH);
 
   } else if (watch) {
 
@@ -148,3 +148,79 @@ mpl_app_launches_query_lookup (MplAppLaunchesQuery   *self,
                                         error);
 }
 
+/*
+ * Look up a batch of executables in a single pass over the database.
+ * results_out must hold n_executables entries, they are filled in the order
+ * of executables. The number of executables that have been launched at least
+ * once is returned in n_found_out.
+ */
+bool
+mpl_app_launches_query_lookup_many (MplAppLaunchesQuery    *self,
+                                    char const * const     *executables,
+                                    unsigned                n_executables,
+                                    MplAppLaunchesResult   *results_out,
+                                    unsigned               *n_found_out,
+                                    GError                **error)
+{
+  MplAppLaunchesQueryPrivate *priv = GET_PRIVATE (self);
+  unsigned i;
+
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_QUERY (self), false);
+  g_return_val_if_fail (executables || 0 == n_executables, false);
+  g_return_val_if_fail (results_out || 0 == n_executables, false);
+
+  for (i = 0; i < n_executables; i++)
+  {
+    results_out[i].executable = executables[i];
+    results_out[i].hash = mpl_app_launches_query_hash (executables[i]);
+  }
+
+  return mpl_app_launches_store_lookup_many (priv->store,
+                                             results_out,
+                                             n_executables,
+                                             n_found_out,
+                                             error);
+}
+
+/*
+ * Get the up to n_results most recently or most frequently launched
+ * executables, best first. The number of results filled in is returned
+ * in n_found_out.
+ * Only hashes are stored in the database, so the executable field of the
+ * results is NULL; match them using mpl_app_launches_query_hash().
+ */
+bool
+mpl_app_launches_query_get_top (MplAppLaunchesQuery       *self,
+                                MplAppLaunchesQueryOrder   order,
+                                unsigned                   n_results,
+                                MplAppLaunchesResult      *results_out,
+                                unsigned                  *n_found_out,
+                                GError                   **error)
+{
+  MplAppLaunchesQueryPrivate *priv = GET_PRIVATE (self);
+  bool ret;
+
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_QUERY (self), false);
+  g_return_val_if_fail (results_out || 0 == n_results, false);
+
+  ret = mpl_app_launches_store_get_top (priv->store,
+                                        order,
+                                        results_out,
+                                        &n_results,
+                                        error);
+  if (n_found_out)
+    *n_found_out = ret ? n_results : 0;
+
+  return ret;
+}
+
+/*
+ * Hash under which the launches of executable are stored.
+ */
+uint32_t
+mpl_app_launches_query_hash (char const *executable)
+{
+  g_return_val_if_fail (executable, 0);
+
+  return g_str_hash (executable);
+}
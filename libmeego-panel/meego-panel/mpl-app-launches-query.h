@@ -56,6 +56,25 @@ typedef struct
   GObjectClass parent;
 } MplAppLaunchesQueryClass;
 
+typedef enum
+{
+  MPL_APP_LAUNCHES_QUERY_MOST_RECENT,
+  MPL_APP_LAUNCHES_QUERY_MOST_FREQUENT
+} MplAppLaunchesQueryOrder;
+
+/*
+ * Result of a batch or top-N query. Results of top-N queries only carry
+ * the hash, see mpl_app_launches_query_hash(), executable is NULL.
+ * Executables that have never been launched have n_launches set to 0.
+ */
+typedef struct
+{
+  char const  *executable;
+  uint32_t     hash;
+  time_t       last_launched;
+  uint32_t     n_launches;
+} MplAppLaunchesResult;
+
 GType
 mpl_app_launches_query_get_type (void);
 
@@ -66,6 +85,25 @@ mpl_app_launches_query_lookup (MplAppLaunchesQuery   *self,
                                uint32_t              *n_launches_out,
                                GError               **error);
 
+bool
+mpl_app_launches_query_lookup_many (MplAppLaunchesQuery    *self,
+                                    char const * const     *executables,
+                                    unsigned                n_executables,
+                                    MplAppLaunchesResult   *results_out,
+                                    unsigned               *n_found_out,
+                                    GError                **error);
+
+bool
+mpl_app_launches_query_get_top (MplAppLaunchesQuery       *self,
+                                MplAppLaunchesQueryOrder   order,
+                                unsigned                   n_results,
+                                MplAppLaunchesResult      *results_out,
+                                unsigned                  *n_found_out,
+                                GError                   **error);
+
+uint32_t
+mpl_app_launches_query_hash (char const *executable);
+
 G_END_DECLS
 
 #endif /* MPL_APP_LAUNCHES_QUERY_H */
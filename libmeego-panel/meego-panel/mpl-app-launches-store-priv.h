@@ -34,5 +34,19 @@ bool
 mpl_app_launches_store_close (MplAppLaunchesStore  *self,
                               GError              **error_out);
 
+bool
+mpl_app_launches_store_lookup_many (MplAppLaunchesStore   *self,
+                                    MplAppLaunchesResult  *results,
+                                    unsigned               n_results,
+                                    unsigned              *n_found_out,
+                                    GError               **error_out);
+
+bool
+mpl_app_launches_store_get_top (MplAppLaunchesStore       *self,
+                                MplAppLaunchesQueryOrder   order,
+                                MplAppLaunchesResult      *results,
+                                unsigned                  *n_results_inout,
+                                GError                   **error_out);
+
 #endif /* MPL_APP_LAUNCHES_STORE_PRIV_H */
 
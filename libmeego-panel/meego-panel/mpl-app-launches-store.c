@@ -1,4 +1,3 @@
-
 /*
  * Copyright (c) 2010 Intel Corporation.
  *
@@ -21,10 +20,20 @@
  */
 
 /*
- * FIXME
- * Maybe create an "mpl-app-launches-store-insert" executable that
- * can be spawned from any process that wants to insert. This would
- * delegate the queueing to the kernel.
+ * The store consists of two files:
+ *
+ * - The sorted database file, which is looked up using bsearch(). It is never
+ *   modified in place, only ever replaced (atomically, using rename()).
+ *
+ * - A journal, "<database-file>.journal", to which new launches are
+ *   appended. Lookups take both files into account. Once the journal grows
+ *   past JOURNAL_MAX_RECORDS it is merged into a new database file, and
+ *   truncated. This keeps recording a launch O(1) in disk I/O.
+ *
+ * The journal lock serialises writers and compaction; readers take a shared
+ * journal lock while they read the journal and map the database file, so
+ * they never see a launch both in the journal and the database file. Locks
+ * are always taken journal first.
  */
 
 #define _GNU_SOURCE /* for comparison_fn_t from stdlib.h */
@@ -61,26 +70,73 @@ enum
   LAST_SIGNAL
 };
 
+/*
+ * Database and journal files start with a header, followed by packed
+ * records. The database file's records are sorted by hash.
+ */
+#define MPL_APP_LAUNCHES_MAGIC    "MPLAPPL" /* incl. '\0' */
+#define MPL_APP_LAUNCHES_VERSION  1
+
+typedef struct
+{
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  reserved;
+} __attribute__ ((packed)) MplAppLaunchesHeader;
+
 /*
  * Record as persisted to disk.
  */
 typedef struct
+{
+  uint32_t  hash;           /* Hash of executable name */
+  int64_t   last_launched;  /* time_t of the last launch */
+  uint32_t  n_launches;     /* Total launches */
+} __attribute__ ((packed)) MplAppLaunchesRecord;
+
+/*
+ * Record as persisted to disk before the binary format was introduced.
+ * Files in this format have no header; they are still read, and migrated
+ * on the first write.
+ */
+typedef struct
 {
   char    hash[9];          /* Hash of executable name as hex-string, incl. '\n' */
   char    last_launched[9]; /* Hash of time_t as hex-string, incl. '\n' */
   char    n_launches[9];    /* Hash of total launches as hex string, incl. '\n' */
   char    newline;
-} MplAppLaunchesRecord;
+} MplAppLaunchesTextRecord;
 
+/* Number of journal records that triggers merging into the database file. */
+#define JOURNAL_MAX_RECORDS 128
+
+/*
+ * Launch queued by mpl_app_launches_store_add_async().
+ */
 typedef struct
 {
-  char                  *database_file;
-  GFileMonitor          *monitor;
-  int                    fd;
-  MplAppLaunchesRecord  *data;
-  size_t                 size;
-  unsigned               mmap_reference_count;
-  bool                   for_writing;
+  char    *executable;
+  time_t   timestamp;
+} MplAppLaunchesPending;
+
+typedef struct
+{
+  char                        *database_file;
+  char                        *journal_file;
+  GFileMonitor                *monitor;
+  GFileMonitor                *journal_monitor;
+  int                          fd;
+  void                        *data;
+  size_t                       size;
+  MplAppLaunchesRecord const  *records;
+  unsigned                     n_records;
+  GArray                      *converted;
+  GArray                      *journal;
+  GArray                      *pending;
+  unsigned                     flush_id;
+  unsigned                     mmap_reference_count;
+  bool                         for_writing;
+  bool                         text_format;
 } MplAppLaunchesStorePrivate;
 
 #define PROPAGATE_ERROR_AND_RETURN_IF_FAIL(condition_, error_, error_ptr_)  \
@@ -160,6 +216,7 @@ _set_property (GObject      *object,
   case PROP_DATABASE_FILE:
     /* Construct-only */
     priv->database_file = g_value_dup_string (value);
+    priv->journal_file = g_strconcat (priv->database_file, ".journal", NULL);
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -182,6 +239,20 @@ _constructed (GObject *object)
     g_signal_connect (priv->monitor, "changed",
                       G_CALLBACK (_database_file_changed_cb), object);
   }
+  g_object_unref (file);
+
+  file = g_file_new_for_path (priv->journal_file);
+  priv->journal_monitor = g_file_monitor (file, G_FILE_MONITOR_NONE,
+                                          NULL, &error);
+  if (error)
+  {
+    g_warning ("%s : %s", G_STRLOC, error->message);
+    g_clear_error (&error);
+  } else {
+    g_signal_connect (priv->journal_monitor, "changed",
+                      G_CALLBACK (_database_file_changed_cb), object);
+  }
+  g_object_unref (file);
 }
 
 static void
@@ -189,18 +260,55 @@ _dispose (GObject *object)
 {
   MplAppLaunchesStorePrivate *priv = GET_PRIVATE (object);
 
+  /* Write out launches still waiting for the idle flush while the file
+   * names are still around. */
+  if (priv->flush_id)
+  {
+    g_source_remove (priv->flush_id);
+    priv->flush_id = 0;
+  }
+
+  if (priv->pending)
+  {
+    mpl_app_launches_store_flush (MPL_APP_LAUNCHES_STORE (object), NULL);
+  }
+
   if (priv->database_file)
   {
     g_free (priv->database_file);
     priv->database_file = NULL;
   }
 
+  if (priv->journal_file)
+  {
+    g_free (priv->journal_file);
+    priv->journal_file = NULL;
+  }
+
   if (priv->monitor)
   {
     g_object_unref (priv->monitor);
     priv->monitor = NULL;
   }
 
+  if (priv->journal_monitor)
+  {
+    g_object_unref (priv->journal_monitor);
+    priv->journal_monitor = NULL;
+  }
+
+  if (priv->converted)
+  {
+    g_array_free (priv->converted, true);
+    priv->converted = NULL;
+  }
+
+  if (priv->journal)
+  {
+    g_array_free (priv->journal, true);
+    priv->journal = NULL;
+  }
+
   G_OBJECT_CLASS (mpl_app_launches_store_parent_class)->dispose (object);
 }
 
@@ -262,67 +370,375 @@ static int
 _compare_cb (MplAppLaunchesRecord const *a,
              MplAppLaunchesRecord const *b)
 {
-  int ret;
+  if (a->hash < b->hash)
+    return -1;
+  if (a->hash > b->hash)
+    return 1;
+  return 0;
+}
 
-  /* strncmp ought to work for padded '\0' terminated hex strings  */
-  ret = strncmp (a->hash, b->hash, sizeof (a->hash) - 1);
-  return ret;
+static bool
+header_check (void const  *data,
+              size_t       size)
+{
+  MplAppLaunchesHeader const *header = data;
+
+  return size >= sizeof (*header) &&
+         0 == memcmp (header->magic,
+                      MPL_APP_LAUNCHES_MAGIC,
+                      sizeof (header->magic)) &&
+         MPL_APP_LAUNCHES_VERSION == header->version;
 }
 
 static void
-record_read (MplAppLaunchesRecord const *record,
-             uint32_t                   *hash_out,
-             time_t                     *last_launched_out,
-             uint32_t                   *n_launches_out)
+text_record_read (MplAppLaunchesTextRecord const *text_record,
+                  MplAppLaunchesRecord           *record)
 {
-  if (hash_out)
-    sscanf (record->hash, "%x", hash_out);
+  unsigned long last_launched = 0;
+
+  record->hash = 0;
+  record->n_launches = 0;
 
-  if (last_launched_out)
-    sscanf (record->last_launched, "%lx", last_launched_out);
+  sscanf (text_record->hash, "%x", &record->hash);
+  sscanf (text_record->last_launched, "%lx", &last_launched);
+  sscanf (text_record->n_launches, "%x", &record->n_launches);
 
-  if (n_launches_out)
-    sscanf (record->n_launches, "%x", n_launches_out);
+  record->last_launched = last_launched;
 }
 
-static void
-record_update (MplAppLaunchesRecord *record,
-               int32_t               hash,
-               time_t                timestamp)
+/*
+ * Parse the contents of a database or journal file, in either format.
+ * Returns an array of MplAppLaunchesRecord, in file order.
+ */
+static GArray *
+records_parse (void const *data,
+               size_t      size,
+               bool       *text_format_out)
 {
-  uint32_t n_launches = 0;
+  GArray   *records;
+  unsigned  n_records;
+  unsigned  i;
+
+  records = g_array_new (false, false, sizeof (MplAppLaunchesRecord));
+
+  if (0 == size)
+  {
+    if (text_format_out)
+      *text_format_out = false;
+
+  } else if (header_check (data, size)) {
+
+    n_records = (size - sizeof (MplAppLaunchesHeader)) /
+                sizeof (MplAppLaunchesRecord);
+    g_array_append_vals (records,
+                         (char const *) data + sizeof (MplAppLaunchesHeader),
+                         n_records);
+    if (text_format_out)
+      *text_format_out = false;
+
+  } else {
 
-  if (hash)
-    snprintf (record->hash, sizeof (record->hash), "%08x", hash);
+    MplAppLaunchesTextRecord const *text_records = data;
 
-  if (timestamp)
-    snprintf (record->last_launched, sizeof (record->last_launched),
-              "%08lx", timestamp);
+    n_records = size / sizeof (MplAppLaunchesTextRecord);
+    g_array_set_size (records, n_records);
+    for (i = 0; i < n_records; i++)
+    {
+      text_record_read (&text_records[i],
+                        &g_array_index (records, MplAppLaunchesRecord, i));
+    }
+    if (text_format_out)
+      *text_format_out = true;
+  }
 
-  record_read (record, NULL, NULL, &n_launches);
-  snprintf (record->n_launches, sizeof (record->n_launches),
-            "%08x", n_launches + 1);
+  return records;
 }
 
 static bool
-record_write (MplAppLaunchesRecord   *record,
-              int                     fd,
-              GError                **error_out)
+write_all (int          fd,
+           void const  *data,
+           size_t       size,
+           GError     **error_out)
 {
   ssize_t n_bytes;
 
-  n_bytes = write (fd, record, sizeof (*record));
-  if (n_bytes < 0)
+  while (size > 0)
+  {
+    n_bytes = write (fd, data, size);
+    if (n_bytes < 0 && EINTR == errno)
+      continue;
+
+    if (n_bytes < 0)
+    {
+      if (error_out)
+        *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                  MPL_APP_LAUNCHES_STORE_ERROR_WRITING_DATABASE,
+                                  "%s : %s",
+                                  G_STRLOC, strerror (errno));
+      return false;
+    }
+
+    data = (char const *) data + n_bytes;
+    size -= n_bytes;
+  }
+
+  return true;
+}
+
+static bool
+header_write (int      fd,
+              GError **error_out)
+{
+  MplAppLaunchesHeader header = { { 0, }, };
+
+  memcpy (header.magic, MPL_APP_LAUNCHES_MAGIC, sizeof (header.magic));
+  header.version = MPL_APP_LAUNCHES_VERSION;
+
+  return write_all (fd, &header, sizeof (header), error_out);
+}
+
+/*
+ * Fold other into the accumulated record for the same executable.
+ */
+static void
+record_merge (MplAppLaunchesRecord        *record,
+              MplAppLaunchesRecord const  *other)
+{
+  record->n_launches += other->n_launches;
+  if (other->last_launched > record->last_launched)
+    record->last_launched = other->last_launched;
+}
+
+/*
+ * Sort records by hash, folding multiple launches of the same executable.
+ */
+static void
+records_fold (GArray *records)
+{
+  unsigned i, j;
+
+  g_array_sort (records, (GCompareFunc) _compare_cb);
+  for (i = 0, j = 0; i < records->len; i++)
+  {
+    MplAppLaunchesRecord *record = &g_array_index (records,
+                                                   MplAppLaunchesRecord, i);
+    if (j > 0 &&
+        g_array_index (records, MplAppLaunchesRecord, j - 1).hash == record->hash)
+    {
+      record_merge (&g_array_index (records, MplAppLaunchesRecord, j - 1),
+                    record);
+    } else {
+      g_array_index (records, MplAppLaunchesRecord, j++) = *record;
+    }
+  }
+  g_array_set_size (records, j);
+}
+
+/*
+ * Merge sorted records with a sorted and folded journal.
+ * Returns a new array of MplAppLaunchesRecord, sorted by hash.
+ */
+static GArray *
+records_merge (MplAppLaunchesRecord const *records,
+               unsigned                    n_records,
+               GArray                     *journal)
+{
+  GArray    *merged;
+  unsigned   i, j;
+
+  merged = g_array_sized_new (false, false, sizeof (MplAppLaunchesRecord),
+                              n_records + journal->len);
+  for (i = 0, j = 0; i < n_records || j < journal->len; )
+  {
+    MplAppLaunchesRecord const  *record = NULL;
+    MplAppLaunchesRecord const  *logged = NULL;
+
+    if (i < n_records)
+      record = &records[i];
+    if (j < journal->len)
+      logged = &g_array_index (journal, MplAppLaunchesRecord, j);
+
+    if (record && logged && record->hash == logged->hash)
+    {
+      MplAppLaunchesRecord sum = *record;
+      record_merge (&sum, logged);
+      g_array_append_val (merged, sum);
+      i++;
+      j++;
+    } else if (logged && (NULL == record || logged->hash < record->hash)) {
+      g_array_append_val (merged, *logged);
+      j++;
+    } else {
+      g_array_append_val (merged, *record);
+      i++;
+    }
+  }
+
+  return merged;
+}
+
+/*
+ * Read the journal from the start of fd.
+ * Returns an array of MplAppLaunchesRecord, in the order they were logged.
+ */
+static GArray *
+journal_read (int       fd,
+              bool     *text_format_out,
+              GError  **error_out)
+{
+  GArray      *journal;
+  struct stat  sb;
+  char        *data;
+  ssize_t      n_bytes;
+  size_t       size = 0;
+
+  if (-1 == fstat (fd, &sb))
   {
     if (error_out)
       *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
-                                MPL_APP_LAUNCHES_STORE_ERROR_WRITING_DATABASE,
+                                MPL_APP_LAUNCHES_STORE_ERROR_READING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
-    return false;
+    return NULL;
   }
 
-  return true;
+  data = g_malloc (sb.st_size);
+  while (size < (size_t) sb.st_size)
+  {
+    n_bytes = pread (fd, data + size, sb.st_size - size, size);
+    if (n_bytes < 0 && EINTR == errno)
+      continue;
+
+    if (n_bytes < 0)
+    {
+      if (error_out)
+        *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                  MPL_APP_LAUNCHES_STORE_ERROR_READING_DATABASE,
+                                  "%s : %s",
+                                  G_STRLOC, strerror (errno));
+      g_free (data);
+      return NULL;
+    }
+
+    if (0 == n_bytes)
+      break;
+
+    size += n_bytes;
+  }
+
+  journal = records_parse (data, size, text_format_out);
+  g_free (data);
+
+  return journal;
+}
+
+/*
+ * Load the journal into memory, leaving it locked with lock_flags.
+ * Returns the journal's fd, or -1 if it does not exist (in which case
+ * the in-memory journal is empty).
+ */
+static int
+journal_load (MplAppLaunchesStore  *self,
+              int                   lock_flags,
+              GError              **error_out)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  int     fd;
+  GError *error = NULL;
+
+  if (priv->journal)
+  {
+    g_array_free (priv->journal, true);
+    priv->journal = NULL;
+  }
+
+  fd = open (priv->journal_file, O_RDONLY);
+  if (-1 == fd)
+  {
+    if (ENOENT != errno && error_out)
+      *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
+                                "%s : %s",
+                                G_STRLOC, strerror (errno));
+    priv->journal = g_array_new (false, false, sizeof (MplAppLaunchesRecord));
+    return -1;
+  }
+
+  if (-1 == flock (fd, lock_flags))
+  {
+    if (error_out)
+      *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
+                                "%s : %s",
+                                G_STRLOC, strerror (errno));
+    close (fd);
+    priv->journal = g_array_new (false, false, sizeof (MplAppLaunchesRecord));
+    return -1;
+  }
+
+  priv->journal = journal_read (fd, NULL, &error);
+  if (error)
+  {
+    if (error_out)
+      *error_out = error;
+    else
+      g_clear_error (&error);
+    flock (fd, LOCK_UN);
+    close (fd);
+    priv->journal = g_array_new (false, false, sizeof (MplAppLaunchesRecord));
+    return -1;
+  }
+
+  return fd;
+}
+
+static void
+journal_unlock (int fd)
+{
+  if (-1 == fd)
+    return;
+
+  if (-1 == flock (fd, LOCK_UN))
+  {
+    g_warning ("%s : %s", G_STRLOC, strerror (errno));
+  }
+
+  if (-1 == close (fd))
+  {
+    g_warning ("%s : %s", G_STRLOC, strerror (errno));
+  }
+}
+
+/*
+ * Point priv->records at the sorted records of the mapped database file.
+ * Files in the text format are converted in memory.
+ */
+static void
+store_index_records (MplAppLaunchesStore *self)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+
+  priv->records = NULL;
+  priv->n_records = 0;
+  priv->text_format = false;
+
+  if (NULL == priv->data || 0 == priv->size)
+    return;
+
+  if (header_check (priv->data, priv->size))
+  {
+    priv->records = (MplAppLaunchesRecord const *)
+                      ((char const *) priv->data + sizeof (MplAppLaunchesHeader));
+    priv->n_records = (priv->size - sizeof (MplAppLaunchesHeader)) /
+                      sizeof (MplAppLaunchesRecord);
+  } else {
+    /* Zero-padded hex strings sort the same as the numbers they represent,
+     * so the converted records are sorted already. */
+    priv->converted = records_parse (priv->data, priv->size, NULL);
+    priv->records = (MplAppLaunchesRecord const *) priv->converted->data;
+    priv->n_records = priv->converted->len;
+    priv->text_format = true;
+  }
 }
 
 /*
@@ -339,6 +755,7 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
   int         open_mode;
   int         mmap_protect;
   int         lock_flags;
+  int         journal_fd;
   struct stat sb;
   bool        ret = true;
 
@@ -364,9 +781,17 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
   priv->size = 0;
   priv->for_writing = for_writing;
 
+  /* Keep the journal locked until the database file is mapped, so that
+   * compaction cannot happen in between. */
+  journal_fd = journal_load (self, for_writing ? LOCK_EX : LOCK_SH, error_out);
+  if (error_out && *error_out)
+    return false;
+
   /* Empty (non existant) store is fine. */
   if (!g_file_test (priv->database_file, G_FILE_TEST_IS_REGULAR))
   {
+    priv->mmap_reference_count = 1;
+    journal_unlock (journal_fd);
     return true;
   }
 
@@ -389,6 +814,7 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
                                 MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
+    journal_unlock (journal_fd);
     return false;
   }
 
@@ -399,6 +825,7 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
                                 MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
+    journal_unlock (journal_fd);
     return false;
   }
 
@@ -409,6 +836,7 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
                                 MPL_APP_LAUNCHES_STORE_ERROR_READING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
+    journal_unlock (journal_fd);
     return false;
   }
 
@@ -427,8 +855,11 @@ mpl_app_launches_store_open (MplAppLaunchesStore  *self,
     ret = false;
   } else {
     priv->mmap_reference_count = 1;
+    store_index_records (self);
   }
 
+  journal_unlock (journal_fd);
+
   return ret;
 }
 
@@ -454,7 +885,7 @@ mpl_app_launches_store_close (MplAppLaunchesStore  *self,
   {
     /* Store is not empty/non-exist, close it. */
 
-    if (-1 == munmap ((void *) priv->data, priv->size))
+    if (-1 == munmap (priv->data, priv->size))
     {
       error = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
                            MPL_APP_LAUNCHES_STORE_ERROR_CLOSING_DATABASE,
@@ -475,46 +906,154 @@ mpl_app_launches_store_close (MplAppLaunchesStore  *self,
     priv->fd = 0;
     priv->data = NULL;
     priv->size = 0;
-    priv->mmap_reference_count = 0;
+  }
+
+  priv->records = NULL;
+  priv->n_records = 0;
+  priv->mmap_reference_count = 0;
+
+  if (priv->converted)
+  {
+    g_array_free (priv->converted, true);
+    priv->converted = NULL;
+  }
 
-    PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+  if (priv->journal)
+  {
+    g_array_free (priv->journal, true);
+    priv->journal = NULL;
   }
 
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
   return true;
 }
 
-static MplAppLaunchesRecord *
-store_lookup_hash (MplAppLaunchesStore  *self,
-                   uint32_t              hash,
-                   GError              **error_out)
+/*
+ * Look up hash in both the database file and the journal.
+ * The store must be open.
+ */
+static bool
+store_lookup (MplAppLaunchesStore   *self,
+              uint32_t               hash,
+              MplAppLaunchesRecord  *record_out)
 {
   MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
-  MplAppLaunchesRecord  *record;
-  MplAppLaunchesRecord   key;
-
-  snprintf (key.hash, sizeof (key.hash), "%08x", hash);
-
-  record = bsearch (&key, priv->data,
-                    priv->size / sizeof (MplAppLaunchesRecord),
+  MplAppLaunchesRecord const  *record;
+  MplAppLaunchesRecord         key;
+  bool                         found = false;
+  unsigned                     i;
+
+  record_out->hash = hash;
+  record_out->last_launched = 0;
+  record_out->n_launches = 0;
+
+  key.hash = hash;
+  record = bsearch (&key, priv->records,
+                    priv->n_records,
                     sizeof (MplAppLaunchesRecord),
                     (comparison_fn_t) _compare_cb);
+  if (record)
+  {
+    *record_out = *record;
+    found = true;
+  }
 
-  return record;
+  for (i = 0; priv->journal && i < priv->journal->len; i++)
+  {
+    MplAppLaunchesRecord *logged = &g_array_index (priv->journal,
+                                                   MplAppLaunchesRecord, i);
+    if (logged->hash == hash)
+    {
+      record_merge (record_out, logged);
+      found = true;
+    }
+  }
+
+  return found;
 }
 
-static char *
-store_insert (MplAppLaunchesStore   *self,
-              uint32_t               hash,
-              time_t                 timestamp,
-              GError               **error_out)
+/*
+ * Whether the database file needs to be rewritten in the current format.
+ */
+static bool
+store_needs_migration (MplAppLaunchesStore *self)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesHeader  header;
+  ssize_t               n_bytes;
+  int                   fd;
+
+  fd = open (priv->database_file, O_RDONLY);
+  if (-1 == fd)
+    return false;
+
+  n_bytes = read (fd, &header, sizeof (header));
+  close (fd);
+
+  return n_bytes > 0 && !header_check (&header, n_bytes);
+}
+
+/*
+ * Merge the sorted database file and the journal into a new database file,
+ * and truncate the journal. The journal must be locked exclusively by the
+ * caller, and passed as journal_fd.
+ * Database files in the text format are migrated to the binary format here.
+ */
+static bool
+store_compact (MplAppLaunchesStore   *self,
+               int                    journal_fd,
+               GError               **error_out)
 {
   MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
-  char       template[] = "/tmp/meego-app-launches-store-XXXXXX";
-  int        fd;
-  unsigned   n_elements;
-  unsigned   i;
-  GError    *error = NULL;
+  void                  *data = NULL;
+  size_t                 size = 0;
+  GArray                *records;
+  GArray                *journal;
+  GArray                *merged;
+  char                  *template;
+  int                    db_fd;
+  int                    fd;
+  GError                *error = NULL;
+
+  journal = journal_read (journal_fd, NULL, &error);
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (journal, error, error_out);
 
+  records_fold (journal);
+
+  /* The database file is never modified in place, so no need to lock it. */
+  db_fd = open (priv->database_file, O_RDONLY);
+  if (-1 != db_fd)
+  {
+    struct stat sb;
+    if (0 == fstat (db_fd, &sb) && sb.st_size > 0)
+    {
+      size = sb.st_size;
+      data = mmap (0, size, PROT_READ, MAP_SHARED, db_fd, 0);
+      if ((void *) -1 == data)
+      {
+        data = NULL;
+        size = 0;
+      }
+    }
+  }
+
+  records = records_parse (data, size, NULL);
+
+  if (data)
+    munmap (data, size);
+  if (-1 != db_fd)
+    close (db_fd);
+
+  merged = records_merge ((MplAppLaunchesRecord const *) records->data,
+                          records->len,
+                          journal);
+
+  g_array_free (records, true);
+  g_array_free (journal, true);
+
+  /* Temporary file must be on the same file system for rename() to work. */
+  template = g_strconcat (priv->database_file, ".XXXXXX", NULL);
   fd = mkstemp (template);
   if (-1 == fd)
   {
@@ -523,53 +1062,126 @@ store_insert (MplAppLaunchesStore   *self,
                                 MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
-    return NULL;
+    g_array_free (merged, true);
+    g_free (template);
+    return false;
   }
 
-  n_elements = priv->size / sizeof (MplAppLaunchesRecord);
-  for (i = 0; i < n_elements; i++)
+  if (header_write (fd, &error))
   {
-    if (hash)
-    {
-      /* Test for insert position. */
-      uint32_t current_hash;
-      record_read (&priv->data[i], &current_hash, NULL, NULL);
-      if (current_hash > hash)
-      {
-        /* Insert new record here. */
-        MplAppLaunchesRecord record = { "00000000", "00000000", "00000000", '\n' };
-        record_update (&record, hash, timestamp);
-        hash = 0;
-        if (!record_write (&record, fd, &error))
-          break;
-      }
-    }
+    write_all (fd, merged->data,
+               merged->len * sizeof (MplAppLaunchesRecord), &error);
+  }
+  g_array_free (merged, true);
 
-    if (!record_write (&priv->data[i], fd, &error))
-      break;
+  if (-1 == close (fd) && !error)
+  {
+    error = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                         MPL_APP_LAUNCHES_STORE_ERROR_CLOSING_DATABASE,
+                         "%s : %s",
+                         G_STRLOC, strerror (errno));
   }
 
-  if (hash)
+  if (!error && -1 == rename (template, priv->database_file))
   {
-    /* Insert new record at the end. */
-    MplAppLaunchesRecord record = { "00000000", "00000000", "00000000", '\n' };
-    record_update (&record, hash, timestamp);
-    record_write (&record, fd, &error);
+    error = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                         MPL_APP_LAUNCHES_STORE_ERROR_WRITING_DATABASE,
+                         "%s : %s",
+                         G_STRLOC, strerror (errno));
   }
 
-  PROPAGATE_ERROR_AND_RETURN_IF_FAIL_WITH_CODE (!error, error, error_out, close (fd));
+  if (error)
+  {
+    unlink (template);
+    g_free (template);
+    PROPAGATE_ERROR_AND_RETURN_IF_FAIL (false, error, error_out);
+  }
+  g_free (template);
 
-  if (-1 == close (fd))
+  if (-1 == ftruncate (journal_fd, 0))
   {
     if (error_out)
       *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
-                                MPL_APP_LAUNCHES_STORE_ERROR_CLOSING_DATABASE,
+                                MPL_APP_LAUNCHES_STORE_ERROR_WRITING_DATABASE,
                                 "%s : %s",
                                 G_STRLOC, strerror (errno));
-    return NULL;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Append launch records to the journal in a single locked write; the journal
+ * is merged into the database file once it grows past JOURNAL_MAX_RECORDS.
+ */
+static bool
+store_append (MplAppLaunchesStore         *self,
+              MplAppLaunchesRecord const  *records,
+              unsigned                     n_records,
+              GError                     **error_out)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesHeader   header;
+  struct stat            sb;
+  ssize_t                n_bytes;
+  int                    fd;
+  GError                *error = NULL;
+
+  fd = open (priv->journal_file, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (-1 == fd)
+  {
+    if (error_out)
+      *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
+                                "%s : %s",
+                                G_STRLOC, strerror (errno));
+    return false;
+  }
+
+  if (-1 == flock (fd, LOCK_EX))
+  {
+    if (error_out)
+      *error_out = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
+                                MPL_APP_LAUNCHES_STORE_ERROR_OPENING_DATABASE,
+                                "%s : %s",
+                                G_STRLOC, strerror (errno));
+    close (fd);
+    return false;
   }
 
-  return g_strdup (template);
+  /* One-time migration of files in the text format. */
+  n_bytes = pread (fd, &header, sizeof (header), 0);
+  if ((n_bytes > 0 && !header_check (&header, n_bytes)) ||
+      store_needs_migration (self))
+  {
+    store_compact (self, fd, &error);
+  }
+
+  if (!error && 0 == fstat (fd, &sb) && 0 == sb.st_size)
+  {
+    header_write (fd, &error);
+    sb.st_size = sizeof (MplAppLaunchesHeader);
+  }
+
+  if (!error)
+  {
+    write_all (fd, records, n_records * sizeof (MplAppLaunchesRecord), &error);
+    sb.st_size += n_records * sizeof (MplAppLaunchesRecord);
+  }
+
+  if (!error &&
+      sb.st_size >= (off_t) (sizeof (MplAppLaunchesHeader) +
+                             JOURNAL_MAX_RECORDS * sizeof (MplAppLaunchesRecord)))
+  {
+    store_compact (self, fd, &error);
+  }
+
+  journal_unlock (fd);
+
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
+  return true;
 }
 
 /*
@@ -581,73 +1193,163 @@ mpl_app_launches_store_add (MplAppLaunchesStore  *self,
                             char const           *executable,
                             time_t                timestamp,
                             GError              **error_out)
+{
+  MplAppLaunchesRecord record;
+
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
+  g_return_val_if_fail (executable, false);
+
+  record.hash = g_str_hash (executable);
+  record.last_launched = timestamp ? timestamp : time (NULL);
+  record.n_launches = 1;
+
+  return store_append (self, &record, 1, error_out);
+}
+
+/*
+ * Last resort, have the helper executable record the launch.
+ */
+static bool
+store_add_with_helper (char const  *executable,
+                       time_t       timestamp,
+                       GError     **error)
+{
+  char  *timestamp_str;
+  char  *argv[] = { MEEGO_APP_LAUNCHES_STORE,
+                    "--add", (char *) executable,
+                    "--timestamp", NULL,
+                    NULL };
+  bool   ret;
+
+  timestamp_str = g_strdup_printf ("%li", timestamp);
+  argv[4] = timestamp_str;
+
+  ret = g_spawn_async (NULL, argv, NULL, 0, NULL, NULL, NULL, error);
+  g_free (timestamp_str);
+
+  return ret;
+}
+
+static gboolean
+_flush_cb (MplAppLaunchesStore *self)
 {
   MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
-  MplAppLaunchesRecord  *record = NULL;
-  uint32_t               hash;
+
+  priv->flush_id = 0;
+  mpl_app_launches_store_flush (self, NULL);
+  g_object_unref (self);
+
+  return FALSE;
+}
+
+/*
+ * Write launches queued by mpl_app_launches_store_add_async() right away.
+ * Should the store not be writable, they are handed to the helper
+ * executable instead.
+ */
+bool
+mpl_app_launches_store_flush (MplAppLaunchesStore  *self,
+                              GError              **error_out)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesRecord  *records;
+  GArray                *pending;
+  unsigned               i;
   GError                *error = NULL;
 
   g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
 
-  mpl_app_launches_store_open (self, true, &error);
-  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
-
-  hash = g_str_hash (executable);
+  if (NULL == priv->pending)
+    return true;
 
-  /* Already got a record for this executable? */
-  record = store_lookup_hash (self, hash, &error);
-  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+  /* Detach the queue, launches added from here on start a new one. */
+  pending = priv->pending;
+  priv->pending = NULL;
 
-  if (record)
+  records = g_new (MplAppLaunchesRecord, pending->len);
+  for (i = 0; i < pending->len; i++)
   {
-    record_update (record, 0, timestamp ? timestamp : time (NULL));
-
-  } else {
+    MplAppLaunchesPending *launch = &g_array_index (pending,
+                                                    MplAppLaunchesPending, i);
+    records[i].hash = g_str_hash (launch->executable);
+    records[i].last_launched = launch->timestamp;
+    records[i].n_launches = 1;
+  }
 
-    char *tmp_database_file = store_insert (self,
-                                            hash,
-                                            timestamp ? timestamp : time (NULL),
-                                            &error);
-    PROPAGATE_ERROR_AND_RETURN_IF_FAIL_WITH_CODE (tmp_database_file,
-                                                  error,
-                                                  error_out,
-                                                  mpl_app_launches_store_close (self, NULL));
+  if (!store_append (self, records, pending->len, &error))
+  {
+    g_warning ("%s : %s, falling back to %s",
+               G_STRLOC, error->message, MEEGO_APP_LAUNCHES_STORE);
+    g_clear_error (&error);
 
-    if (-1 == rename (tmp_database_file, priv->database_file))
+    for (i = 0; i < pending->len && !error; i++)
     {
-      error = g_error_new (MPL_APP_LAUNCHES_STORE_ERROR,
-                           MPL_APP_LAUNCHES_STORE_ERROR_WRITING_DATABASE,
-                           "%s : %s",
-                           G_STRLOC, strerror (errno));
+      MplAppLaunchesPending *launch = &g_array_index (pending,
+                                                      MplAppLaunchesPending, i);
+      store_add_with_helper (launch->executable, launch->timestamp, &error);
     }
+  }
 
-    g_free (tmp_database_file);
+  for (i = 0; i < pending->len; i++)
+  {
+    g_free (g_array_index (pending, MplAppLaunchesPending, i).executable);
   }
+  g_array_free (pending, true);
+  g_free (records);
 
-  mpl_app_launches_store_close (self, &error);
   PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
 
   return true;
 }
 
+/*
+ * Add executable launch event to the store without blocking on the
+ * database lock. The launch is queued, and written together with other
+ * launches queued meanwhile from an idle handler, which keeps a reference
+ * on the store until then. Without a running main loop the launch is
+ * written right away.
+ * When 0 is passed for timestamp the current time is used.
+ */
 bool
 mpl_app_launches_store_add_async (MplAppLaunchesStore  *self,
                                   char const           *executable,
                                   time_t                timestamp,
                                   GError              **error)
 {
-  char  *command_line;
-  bool   ret;
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesPending launch;
 
-  command_line = g_strdup_printf ("%s --add %s --timestamp %li",
-                                  MEEGO_APP_LAUNCHES_STORE,
-                                  executable,
-                                  timestamp ? timestamp : time (NULL));
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
+  g_return_val_if_fail (executable, false);
 
-  ret = g_spawn_command_line_async (command_line, error);
-  g_free (command_line);
+  timestamp = timestamp ? timestamp : time (NULL);
 
-  return ret;
+  /* Not called from a main loop (e.g. command line tools), nobody would
+   * dispatch the idle handler. */
+  if (0 == g_main_depth ())
+  {
+    if (mpl_app_launches_store_add (self, executable, timestamp, NULL))
+      return true;
+
+    return store_add_with_helper (executable, timestamp, error);
+  }
+
+  if (NULL == priv->pending)
+    priv->pending = g_array_new (false, false, sizeof (MplAppLaunchesPending));
+
+  launch.executable = g_strdup (executable);
+  launch.timestamp = timestamp;
+  g_array_append_val (priv->pending, launch);
+
+  if (0 == priv->flush_id)
+  {
+    priv->flush_id = g_idle_add_full (G_PRIORITY_LOW,
+                                      (GSourceFunc) _flush_cb,
+                                      g_object_ref (self),
+                                      NULL);
+  }
+
+  return true;
 }
 
 /*
@@ -662,8 +1364,8 @@ mpl_app_launches_store_lookup (MplAppLaunchesStore   *self,
                                uint32_t              *n_launches_out,
                                GError               **error_out)
 {
-  MplAppLaunchesRecord  *record;
-  uint32_t               hash;
+  MplAppLaunchesRecord   record;
+  bool                   found;
   GError                *error = NULL;
 
   g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
@@ -671,20 +1373,237 @@ mpl_app_launches_store_lookup (MplAppLaunchesStore   *self,
   mpl_app_launches_store_open (self, false, &error);
   PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
 
-  hash = g_str_hash (executable);
-  record = store_lookup_hash (self, hash, &error);
-  PROPAGATE_ERROR_AND_RETURN_IF_FAIL_WITH_CODE (!error, error, error_out,
-                                                mpl_app_launches_store_close (self, NULL));
+  found = store_lookup (self, g_str_hash (executable), &record);
+  if (found)
+  {
+    if (last_launched_out)
+      *last_launched_out = (time_t) record.last_launched;
+    if (n_launches_out)
+      *n_launches_out = record.n_launches;
+  }
+
+  mpl_app_launches_store_close (self, &error);
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
+  return found;
+}
+
+static int
+_compare_result_cb (MplAppLaunchesResult * const *a,
+                    MplAppLaunchesResult * const *b)
+{
+  if ((*a)->hash < (*b)->hash)
+    return -1;
+  if ((*a)->hash > (*b)->hash)
+    return 1;
+  return 0;
+}
+
+static void
+result_merge (MplAppLaunchesResult        *result,
+              MplAppLaunchesRecord const  *record)
+{
+  result->n_launches += record->n_launches;
+  if ((time_t) record->last_launched > result->last_launched)
+    result->last_launched = (time_t) record->last_launched;
+}
+
+/*
+ * Look up a batch of executables, whose hashes are passed in results.
+ * The requested hashes are sorted, so the database file is walked only once.
+ * This is private API, see mpl_app_launches_query_lookup_many().
+ */
+bool
+mpl_app_launches_store_lookup_many (MplAppLaunchesStore   *self,
+                                    MplAppLaunchesResult  *results,
+                                    unsigned               n_results,
+                                    unsigned              *n_found_out,
+                                    GError               **error_out)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesResult  **sorted;
+  unsigned                n_found = 0;
+  unsigned                i, j;
+  GError                 *error = NULL;
+
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
+
+  mpl_app_launches_store_open (self, false, &error);
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
+  sorted = g_new (MplAppLaunchesResult *, n_results);
+  for (i = 0; i < n_results; i++)
+  {
+    results[i].last_launched = 0;
+    results[i].n_launches = 0;
+    sorted[i] = &results[i];
+  }
+  qsort (sorted, n_results, sizeof (MplAppLaunchesResult *),
+         (comparison_fn_t) _compare_result_cb);
 
-  if (record)
+  /* Both the database file and the requests are sorted by hash. */
+  for (i = 0, j = 0; i < n_results && j < priv->n_records; )
   {
-    record_read (record, NULL, last_launched_out, n_launches_out);
+    if (sorted[i]->hash < priv->records[j].hash)
+    {
+      i++;
+    } else if (sorted[i]->hash > priv->records[j].hash) {
+      j++;
+    } else {
+      result_merge (sorted[i], &priv->records[j]);
+      i++;
+    }
+  }
+
+  for (i = 0; priv->journal && i < priv->journal->len; i++)
+  {
+    MplAppLaunchesRecord *logged = &g_array_index (priv->journal,
+                                                   MplAppLaunchesRecord, i);
+    MplAppLaunchesResult   key;
+    MplAppLaunchesResult  *key_ptr = &key;
+    MplAppLaunchesResult **match;
+    MplAppLaunchesResult **last = sorted + n_results;
+
+    key.hash = logged->hash;
+    match = bsearch (&key_ptr, sorted, n_results,
+                     sizeof (MplAppLaunchesResult *),
+                     (comparison_fn_t) _compare_result_cb);
+    if (NULL == match)
+      continue;
+
+    /* The same executable may have been requested more than once. */
+    while (match > sorted && (*(match - 1))->hash == key.hash)
+      match--;
+    for (; match < last && (*match)->hash == key.hash; match++)
+      result_merge (*match, logged);
+  }
+
+  for (i = 0; i < n_results; i++)
+  {
+    if (results[i].n_launches > 0)
+      n_found++;
+  }
+
+  g_free (sorted);
+
+  if (n_found_out)
+    *n_found_out = n_found;
+
+  mpl_app_launches_store_close (self, &error);
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
+  return true;
+}
+
+static bool
+record_ranks_before (MplAppLaunchesRecord const *a,
+                     MplAppLaunchesResult const *b,
+                     MplAppLaunchesQueryOrder    order)
+{
+  if (MPL_APP_LAUNCHES_QUERY_MOST_FREQUENT == order &&
+      a->n_launches != b->n_launches)
+    return a->n_launches > b->n_launches;
+
+  if ((time_t) a->last_launched != b->last_launched)
+    return (time_t) a->last_launched > b->last_launched;
+
+  return a->n_launches > b->n_launches;
+}
+
+/*
+ * Fill results with the most recently or frequently launched executables.
+ * On input n_results_inout holds the capacity of results, on output
+ * the number of results filled in.
+ * This is private API, see mpl_app_launches_query_get_top().
+ */
+bool
+mpl_app_launches_store_get_top (MplAppLaunchesStore       *self,
+                                MplAppLaunchesQueryOrder   order,
+                                MplAppLaunchesResult      *results,
+                                unsigned                  *n_results_inout,
+                                GError                   **error_out)
+{
+  MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
+  MplAppLaunchesRecord const  *records;
+  GArray                      *journal = NULL;
+  GArray                      *merged = NULL;
+  unsigned                     n_records;
+  unsigned                     n_results = 0;
+  unsigned                     i, j;
+  GError                      *error = NULL;
+
+  g_return_val_if_fail (MPL_IS_APP_LAUNCHES_STORE (self), false);
+  g_return_val_if_fail (n_results_inout, false);
+
+  mpl_app_launches_store_open (self, false, &error);
+  PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
+
+  records = priv->records;
+  n_records = priv->n_records;
+
+  if (priv->journal && priv->journal->len > 0)
+  {
+    journal = g_array_sized_new (false, false, sizeof (MplAppLaunchesRecord),
+                                 priv->journal->len);
+    g_array_append_vals (journal, priv->journal->data, priv->journal->len);
+    records_fold (journal);
+
+    merged = records_merge (records, n_records, journal);
+    records = (MplAppLaunchesRecord const *) merged->data;
+    n_records = merged->len;
   }
 
+  /* Insertion into the bounded, ordered result list; the number of results
+   * asked for is expected to be small. */
+  for (i = 0; i < n_records; i++)
+  {
+    if (n_results == *n_results_inout &&
+        (0 == n_results ||
+         !record_ranks_before (&records[i], &results[n_results - 1], order)))
+      continue;
+
+    if (n_results < *n_results_inout)
+      n_results++;
+
+    for (j = n_results - 1;
+         j > 0 && record_ranks_before (&records[i], &results[j - 1], order);
+         j--)
+    {
+      results[j] = results[j - 1];
+    }
+
+    results[j].executable = NULL;
+    results[j].hash = records[i].hash;
+    results[j].last_launched = (time_t) records[i].last_launched;
+    results[j].n_launches = records[i].n_launches;
+  }
+
+  *n_results_inout = n_results;
+
+  if (journal)
+    g_array_free (journal, true);
+  if (merged)
+    g_array_free (merged, true);
+
   mpl_app_launches_store_close (self, &error);
   PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
 
-  return (bool) record;
+  return true;
+}
+
+static void
+record_print (MplAppLaunchesRecord const *record,
+              char const                 *annotation)
+{
+  time_t    last_launched = (time_t) record->last_launched;
+  struct tm last_launched_tm;
+  char      last_launched_str[64] = { 0, };
+
+  localtime_r (&last_launched, &last_launched_tm);
+  strftime (last_launched_str, sizeof (last_launched_str),
+            "%Y-%m-%d %H:%M:%S", &last_launched_tm);
+  printf ("%08x\t%s\t%i%s\n",
+          record->hash, last_launched_str, record->n_launches, annotation);
 }
 
 /*
@@ -695,7 +1614,6 @@ mpl_app_launches_store_dump (MplAppLaunchesStore   *self,
                              GError               **error_out)
 {
   MplAppLaunchesStorePrivate *priv = GET_PRIVATE (self);
-  unsigned               n_elements;
   unsigned               i;
   GError                *error = NULL;
 
@@ -704,21 +1622,20 @@ mpl_app_launches_store_dump (MplAppLaunchesStore   *self,
   mpl_app_launches_store_open (self, false, &error);
   PROPAGATE_ERROR_AND_RETURN_IF_FAIL (!error, error, error_out);
 
-  n_elements = priv->size / sizeof (MplAppLaunchesRecord);
-  for (i = 0; i < n_elements; i++)
-  {
-    uint32_t hash;
-    time_t  last_launched;
-    uint32_t n_launches;
-    struct tm last_launched_tm;
-    char last_launched_str[64] = { 0, };
+  if (priv->text_format)
+    printf ("# format: text\n");
+  else
+    printf ("# format: binary, version %i\n", MPL_APP_LAUNCHES_VERSION);
 
-    record_read (&priv->data[i], &hash, &last_launched, &n_launches);
+  for (i = 0; i < priv->n_records; i++)
+  {
+    record_print (&priv->records[i], "");
+  }
 
-    localtime_r (&last_launched, &last_launched_tm);
-    strftime (last_launched_str, sizeof (last_launched_str),
-              "%Y-%m-%d %H:%M:%S", &last_launched_tm);
-    printf ("%08x\t%s\t%i\n", hash, last_launched_str, n_launches);
+  for (i = 0; priv->journal && i < priv->journal->len; i++)
+  {
+    record_print (&g_array_index (priv->journal, MplAppLaunchesRecord, i),
+                  "\t(journal)");
   }
 
   mpl_app_launches_store_close (self, &error);
@@ -738,4 +1655,3 @@ mpl_app_launches_store_create_query (MplAppLaunchesStore *self)
                        "store", self,
                        NULL);
 }
-
@@ -83,6 +83,10 @@ mpl_app_launches_store_add_async (MplAppLaunchesStore  *self,
                                   time_t                timestamp,
                                   GError              **error);
 
+bool
+mpl_app_launches_store_flush (MplAppLaunchesStore  *self,
+                              GError              **error);
+
 bool
 mpl_app_launches_store_lookup (MplAppLaunchesStore   *self,
                                char const            *executable,
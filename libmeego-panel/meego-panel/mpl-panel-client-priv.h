@@ -0,0 +1,47 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mpl-panel-client-priv.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _MPL_PANEL_CLIENT_PRIV
+#define _MPL_PANEL_CLIENT_PRIV
+
+#include "mpl-panel-client.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Applies position and size to the panel window in a single configure; it is
+ * invoked ahead of the ::set-size and ::set-position signals when the Toolbar
+ * changes both at once. This is not a class closure so as to keep the layout
+ * of MplPanelClientClass intact.
+ */
+typedef void (*MplPanelClientGeometryFunc) (MplPanelClient *panel,
+                                            gint            x,
+                                            gint            y,
+                                            guint           width,
+                                            guint           height);
+
+void mpl_panel_client_set_geometry_func (MplPanelClient             *panel,
+                                         MplPanelClientGeometryFunc  func);
+
+G_END_DECLS
+
+#endif /* _MPL_PANEL_CLIENT_PRIV */
@@ -22,8 +22,10 @@
  * 02111-1307, USA.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <glib/gstdio.h>
 #include <dbus/dbus-glib.h>
@@ -36,6 +38,7 @@
 
 #include "mpl-app-launches-store.h"
 #include "mpl-panel-client.h"
+#include "mpl-panel-client-priv.h"
 #include "mpl-panel-common.h"
 #include "marshal.h"
 #include "mnb-enum-types.h"
@@ -106,6 +109,11 @@ struct _MplPanelClientPrivate
   gchar           *stylesheet;
   gchar           *button_style;
   guint            xid;
+  guint            trace_id; /* of the current show or hide request */
+
+  MplAppLaunchesStore *launches_store; /* created on first launch */
+
+  MplPanelClientGeometryFunc geometry_func;
 
   gint             x;
   gint             y;
@@ -210,6 +218,13 @@ mpl_panel_client_dispose (GObject *self)
 {
   MplPanelClientPrivate *priv  = MPL_PANEL_CLIENT (self)->priv;
 
+  if (priv->launches_store)
+    {
+      mpl_app_launches_store_flush (priv->launches_store, NULL);
+      g_object_unref (priv->launches_store);
+      priv->launches_store = NULL;
+    }
+
   if (priv->toolbar_proxy)
     {
       g_object_unref (priv->toolbar_proxy);
@@ -299,6 +314,9 @@ mnb_panel_dbus_init_panel (MplPanelClient  *self,
        */
       mpl_panel_client_hide (self);
 
+      if (priv->geometry_func)
+        priv->geometry_func (self, x, y, width, real_height);
+
       g_signal_emit (self, signals[SET_SIZE], 0, width, real_height);
       g_signal_emit (self, signals[SET_POSITION], 0, x, y);
 
@@ -377,8 +395,11 @@ mnb_panel_dbus_set_position (MplPanelClient  *self,
                              GError         **error)
 {
   MplPanelClientPrivate *priv = self->priv;
-  guint old_x = priv->x;
-  guint old_y = priv->y;
+  gint old_x = priv->x;
+  gint old_y = priv->y;
+
+  priv->x = x;
+  priv->y = y;
 
   if (old_x != priv->x || old_y != priv->y)
     g_signal_emit (self, signals[SET_POSITION], 0, x, y);
@@ -386,16 +407,136 @@ mnb_panel_dbus_set_position (MplPanelClient  *self,
   return TRUE;
 }
 
+/*
+ * Sets both the position and the size of the panel; the window is
+ * reconfigured in one go (via the geometry function, if the subclass
+ * installed one), rather than being first moved and then resized.
+ * The ::set-size and ::set-position signals are still emitted as needed for
+ * the benefit of the panel code.
+ */
+static gboolean
+mnb_panel_dbus_set_geometry (MplPanelClient  *self,
+                             gint             x,
+                             gint             y,
+                             guint            width,
+                             guint            height,
+                             GError         **error)
+{
+  MplPanelClientPrivate *priv = self->priv;
+  guint    real_height = height;
+  gint     old_x = priv->x;
+  gint     old_y = priv->y;
+  guint    old_width = priv->width;
+  guint    old_height = priv->real_height;
+  gboolean size_change, position_change;
+
+  if (height > 0)
+    priv->max_height = height;
+
+  if (width > 0)
+    priv->width = width;
+
+  g_debug ("%s called: %d,%d; width %d (%d), height %d (%d)",
+           __FUNCTION__, x, y, width, priv->width, height, priv->max_height);
+
+  if (priv->requested_height > 0 && priv->requested_height < priv->max_height)
+    real_height = priv->requested_height;
+  else
+    real_height = priv->max_height;
+
+  priv->real_height = real_height;
+  priv->x           = x;
+  priv->y           = y;
+
+  size_change     = (old_width != priv->width || old_height != real_height);
+  position_change = (old_x != x || old_y != y);
+
+  if (!size_change && !position_change)
+    return TRUE;
+
+  if (priv->geometry_func && !priv->windowless)
+    priv->geometry_func (self, x, y, priv->width, real_height);
+
+  if (size_change)
+    g_signal_emit (self, signals[SET_SIZE], 0, priv->width, real_height);
+
+  if (position_change)
+    g_signal_emit (self, signals[SET_POSITION], 0, x, y);
+
+  return TRUE;
+}
+
+/*
+ * Show/hide tracing; when MEEGO_PANEL_TRACE_DIR is set, the stages of each show
+ * and hide request are logged, tagged with the trace id the Toolbar sets with
+ * SetTraceId ahead of the show and hide calls, so that the log can be matched
+ * up with the one the compositor writes (see meego-panel-trace).
+ */
+static FILE *
+mpl_panel_client_trace_file (MplPanelClient *self)
+{
+  static FILE     *trace_file = NULL;
+  static gboolean  initialized = FALSE;
+
+  if (!initialized)
+    {
+      const gchar *dir = g_getenv ("MEEGO_PANEL_TRACE_DIR");
+
+      initialized = TRUE;
+
+      if (dir && *dir)
+        {
+          gchar *basename = g_strdup_printf ("%s.trace", self->priv->name);
+          gchar *path = g_build_filename (dir, basename, NULL);
+
+          if (!(trace_file = fopen (path, "a")))
+            g_warning ("Could not open trace file %s", path);
+
+          g_free (path);
+          g_free (basename);
+        }
+    }
+
+  return trace_file;
+}
+
+static void
+mpl_panel_client_trace (MplPanelClient *self,
+                        guint           trace_id,
+                        const gchar    *event)
+{
+  FILE            *file;
+  struct timespec  ts;
+
+  if (!trace_id || !(file = mpl_panel_client_trace_file (self)))
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  fprintf (file, "%" G_GINT64_FORMAT " %s %u %s\n",
+           (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000) +
+           ts.tv_nsec / 1000,
+           self->priv->name, trace_id, event);
+  fflush (file);
+}
+
 static gboolean
 mnb_panel_dbus_show (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "show-received");
   g_signal_emit (self, signals[SHOW], 0);
+  mpl_panel_client_trace (self, trace_id, "window-shown");
   return TRUE;
 }
 
 static gboolean
 mnb_panel_dbus_show_begin (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "show-begin-received");
   g_signal_emit (self, signals[SHOW_BEGIN], 0);
   return TRUE;
 }
@@ -403,6 +544,9 @@ mnb_panel_dbus_show_begin (MplPanelClient *self, GError **error)
 static gboolean
 mnb_panel_dbus_show_end (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "show-end-received");
   g_signal_emit (self, signals[SHOW_END], 0);
   return TRUE;
 }
@@ -410,13 +554,20 @@ mnb_panel_dbus_show_end (MplPanelClient *self, GError **error)
 static gboolean
 mnb_panel_dbus_hide (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "hide-received");
   g_signal_emit (self, signals[HIDE], 0);
+  mpl_panel_client_trace (self, trace_id, "window-hidden");
   return TRUE;
 }
 
 static gboolean
 mnb_panel_dbus_hide_begin (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "hide-begin-received");
   g_signal_emit (self, signals[HIDE_BEGIN], 0);
   return TRUE;
 }
@@ -424,6 +575,9 @@ mnb_panel_dbus_hide_begin (MplPanelClient *self, GError **error)
 static gboolean
 mnb_panel_dbus_hide_end (MplPanelClient *self, GError **error)
 {
+  guint trace_id = self->priv->trace_id;
+
+  mpl_panel_client_trace (self, trace_id, "hide-end-received");
   g_signal_emit (self, signals[HIDE_END], 0);
   return TRUE;
 }
@@ -434,6 +588,18 @@ mnb_panel_dbus_ping (MplPanelClient *self, GError **error)
   return TRUE;
 }
 
+/*
+ * The Toolbar only calls this when tracing, before the show and hide calls
+ * the id applies to.
+ */
+static gboolean
+mnb_panel_dbus_set_trace_id (MplPanelClient *self, guint trace_id,
+                             GError **error)
+{
+  self->priv->trace_id = trace_id;
+  return TRUE;
+}
+
 static gboolean
 mnb_panel_dbus_unload (MplPanelClient *self, GError **error)
 {
@@ -1198,13 +1364,16 @@ mpl_panel_client_request_modality (MplPanelClient *panel, gboolean modal)
  * required SN housekeeping.
  */
 static gboolean
-mpl_panel_client_launch_application_from_info (GAppInfo *app, GList *files)
+mpl_panel_client_launch_application_from_info (MplPanelClient *panel,
+                                               GAppInfo       *app,
+                                               GList          *files)
 {
-  GAppLaunchContext    *ctx;
-  GdkAppLaunchContext  *gctx;
-  GError               *error = NULL;
-  gboolean              retval = TRUE;
-  guint32               timestamp;
+  MplPanelClientPrivate *priv = panel->priv;
+  GAppLaunchContext     *ctx;
+  GdkAppLaunchContext   *gctx;
+  GError                *error = NULL;
+  gboolean               retval = TRUE;
+  guint32                timestamp;
 
   gctx = gdk_app_launch_context_new ();
   ctx  = G_APP_LAUNCH_CONTEXT (gctx);
@@ -1242,16 +1411,23 @@ mpl_panel_client_launch_application_from_info (GAppInfo *app, GList *files)
     }
   else
     {
-      /* Track app launch */
-      MplAppLaunchesStore *store = mpl_app_launches_store_new ();
+      /*
+       * Track app launch; the store is kept around so that launches in
+       * quick succession are written in one go (anything still pending is
+       * written out when the panel client is disposed).
+       */
       char const *executable = g_app_info_get_executable (app);
-      mpl_app_launches_store_add_async (store, executable, 0, &error);
+
+      if (!priv->launches_store)
+        priv->launches_store = mpl_app_launches_store_new ();
+
+      mpl_app_launches_store_add_async (priv->launches_store, executable, 0,
+                                        &error);
       if (error)
       {
         g_warning ("%s : %s", G_STRLOC, error->message);
         g_clear_error (&error);
       }
-      g_object_unref (store);
     }
 
   g_object_unref (ctx);
@@ -1324,7 +1500,7 @@ mpl_panel_client_launch_application (MplPanelClient *panel,
       return FALSE;
     }
 
-  retval = mpl_panel_client_launch_application_from_info (app, NULL);
+  retval = mpl_panel_client_launch_application_from_info (panel, app, NULL);
 
   g_object_unref (app);
 
@@ -1359,7 +1535,7 @@ mpl_panel_client_launch_application_from_desktop_file (MplPanelClient *panel,
       return FALSE;
     }
 
-  retval = mpl_panel_client_launch_application_from_info (app, files);
+  retval = mpl_panel_client_launch_application_from_info (panel, app, files);
 
   g_object_unref (app);
 
@@ -1613,3 +1789,16 @@ mpl_panel_client_is_windowless (MplPanelClient *panel)
 
   return priv->windowless;
 }
+
+/*
+ * Installs the function used to apply a combined geometry change, see
+ * mpl-panel-client-priv.h.
+ */
+void
+mpl_panel_client_set_geometry_func (MplPanelClient             *panel,
+                                    MplPanelClientGeometryFunc  func)
+{
+  g_return_if_fail (MPL_IS_PANEL_CLIENT (panel));
+
+  panel->priv->geometry_func = func;
+}
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include "mpl-panel-clutter.h"
+#include "mpl-panel-client-priv.h"
 #include "mpl-panel-background.h"
 
 /**
@@ -100,6 +101,12 @@ struct _MplPanelClutterPrivate
   ClutterActor    *tracked_actor;
   guint            height_notify_cb;
 
+  /* geometry last applied to xwindow */
+  gint             x;
+  gint             y;
+  guint            width;
+  guint            height;
+
   gboolean         needs_gdk_pump : 1;
 };
 
@@ -207,18 +214,27 @@ mpl_panel_clutter_set_size (MplPanelClient *self, guint width, guint height)
 
   mpl_panel_clutter_ensure_window ((MplPanelClutter*)self);
 
-  hints.min_width = width;
-  hints.min_height = height;
-  hints.flags = PMinSize;
+  /*
+   * Nothing to do if the window was already resized by set_geometry().
+   */
+  if (priv->width != width || priv->height != height)
+    {
+      hints.min_width = width;
+      hints.min_height = height;
+      hints.flags = PMinSize;
 
-  MPL_X_ERROR_TRAP ();
+      MPL_X_ERROR_TRAP ();
 
-  XSetWMNormalHints (xdpy, priv->xwindow, &hints);
-  XResizeWindow (xdpy, priv->xwindow, width, height);
+      XSetWMNormalHints (xdpy, priv->xwindow, &hints);
+      XResizeWindow (xdpy, priv->xwindow, width, height);
 
-  MPL_X_ERROR_UNTRAP ();
+      MPL_X_ERROR_UNTRAP ();
 
-  clutter_stage_ensure_viewport (CLUTTER_STAGE (priv->stage));
+      priv->width  = width;
+      priv->height = height;
+
+      clutter_stage_ensure_viewport (CLUTTER_STAGE (priv->stage));
+    }
 
   if (p_class->set_size)
     p_class->set_size (self, width, height);
@@ -235,16 +251,56 @@ mpl_panel_clutter_set_position (MplPanelClient *self, gint x, gint y)
 
   mpl_panel_clutter_ensure_window ((MplPanelClutter*)self);
 
-  MPL_X_ERROR_TRAP ();
+  if (priv->x != x || priv->y != y)
+    {
+      MPL_X_ERROR_TRAP ();
 
-  XMoveWindow (xdpy, priv->xwindow, x, y);
+      XMoveWindow (xdpy, priv->xwindow, x, y);
 
-  MPL_X_ERROR_UNTRAP ();
+      MPL_X_ERROR_UNTRAP ();
+
+      priv->x = x;
+      priv->y = y;
+    }
 
   if (p_class->set_position)
     p_class->set_position (self, x, y);
 }
 
+static void
+mpl_panel_clutter_set_geometry (MplPanelClient *self,
+                                gint            x,
+                                gint            y,
+                                guint           width,
+                                guint           height)
+{
+  MplPanelClutterPrivate *priv = MPL_PANEL_CLUTTER (self)->priv;
+  Display                *xdpy = clutter_x11_get_default_display ();
+  XSizeHints              hints;
+
+  clutter_actor_set_size (priv->stage, width, height);
+
+  mpl_panel_clutter_ensure_window ((MplPanelClutter*)self);
+
+  hints.min_width = width;
+  hints.min_height = height;
+  hints.flags = PMinSize;
+
+  MPL_X_ERROR_TRAP ();
+
+  XSetWMNormalHints (xdpy, priv->xwindow, &hints);
+  XMoveResizeWindow (xdpy, priv->xwindow, x, y, width, height);
+
+  MPL_X_ERROR_UNTRAP ();
+
+  priv->x      = x;
+  priv->y      = y;
+  priv->width  = width;
+  priv->height = height;
+
+  clutter_stage_ensure_viewport (CLUTTER_STAGE (priv->stage));
+}
+
 static void
 mpl_panel_clutter_show (MplPanelClient *self)
 {
@@ -294,6 +350,9 @@ mpl_panel_clutter_init (MplPanelClutter *self)
   MplPanelClutterPrivate *priv;
 
   priv = self->priv = MPL_PANEL_CLUTTER_GET_PRIVATE (self);
+
+  mpl_panel_client_set_geometry_func (MPL_PANEL_CLIENT (self),
+                                      mpl_panel_clutter_set_geometry);
 }
 
 /**
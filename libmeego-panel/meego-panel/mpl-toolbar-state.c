@@ -0,0 +1,207 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mpl-toolbar-state.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mpl-toolbar-state.h"
+
+/**
+ * SECTION:mpl-toolbar-state
+ * @short_description: Read-only access to the Toolbar state.
+ * @Title: Toolbar State
+ *
+ * The Toolbar publishes the list of panels, which panel is showing, and
+ * the panel geometry in a shared memory segment. Reading it involves no
+ * round trip to the Toolbar, so this is the preferred way of querying
+ * state that is needed frequently.
+ *
+ * The segment is updated in place; mpl_toolbar_state_get_sequence() provides
+ * a cheap way of checking whether anything changed since the last
+ * mpl_toolbar_state_read().
+ */
+
+/*
+ * How many times to retry reading the snapshot when it is being updated
+ * concurrently; the updates are short, so this is plenty.
+ */
+#define MAX_READ_ATTEMPTS 100
+
+struct _MplToolbarState
+{
+  const MplToolbarStateSegment *segment;
+};
+
+/**
+ * mpl_toolbar_state_open:
+ *
+ * Maps the Toolbar state segment.
+ *
+ * Return value: #MplToolbarState, or %NULL if the state is not available
+ * (e.g., the Toolbar has not been started yet). Free with
+ * mpl_toolbar_state_close().
+ */
+MplToolbarState *
+mpl_toolbar_state_open (void)
+{
+  MplToolbarState *state;
+  gchar           *name;
+  gint             fd;
+  struct stat      st;
+  gpointer         addr;
+
+  name = g_strdup_printf ("%s-%u", MPL_TOOLBAR_STATE_SHM_NAME, getuid ());
+  fd = shm_open (name, O_RDONLY, 0);
+  g_free (name);
+
+  if (fd < 0)
+    return NULL;
+
+  /*
+   * Only trust a segment that is private to us; the name is predictable, so
+   * anyone could have created it.
+   */
+  if (fstat (fd, &st) < 0 ||
+      st.st_uid != getuid () ||
+      (st.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)) != (S_IRUSR | S_IWUSR) ||
+      st.st_size < (off_t) sizeof (MplToolbarStateSegment))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  addr = mmap (NULL, sizeof (MplToolbarStateSegment), PROT_READ, MAP_SHARED,
+               fd, 0);
+  close (fd);
+
+  if (addr == MAP_FAILED)
+    return NULL;
+
+  state = g_slice_new (MplToolbarState);
+  state->segment = addr;
+
+  if (state->segment->magic   != MPL_TOOLBAR_STATE_MAGIC ||
+      state->segment->version != MPL_TOOLBAR_STATE_VERSION)
+    {
+      g_warning ("Toolbar state segment version %u not supported",
+                 state->segment->version);
+
+      mpl_toolbar_state_close (state);
+      return NULL;
+    }
+
+  return state;
+}
+
+/**
+ * mpl_toolbar_state_close:
+ * @state: #MplToolbarState
+ *
+ * Unmaps the Toolbar state segment and frees @state.
+ */
+void
+mpl_toolbar_state_close (MplToolbarState *state)
+{
+  g_return_if_fail (state);
+
+  munmap ((gpointer) state->segment, sizeof (MplToolbarStateSegment));
+  g_slice_free (MplToolbarState, state);
+}
+
+/**
+ * mpl_toolbar_state_get_sequence:
+ * @state: #MplToolbarState
+ *
+ * Retrieves the sequence number of the state; the number changes with each
+ * update of the state.
+ *
+ * Return value: the sequence number.
+ */
+guint
+mpl_toolbar_state_get_sequence (MplToolbarState *state)
+{
+  g_return_val_if_fail (state, 0);
+
+  return g_atomic_int_get ((volatile gint *) &state->segment->sequence);
+}
+
+/**
+ * mpl_toolbar_state_read:
+ * @state: #MplToolbarState
+ * @snapshot: #MplToolbarStateSnapshot to fill in
+ *
+ * Copies the current Toolbar state into @snapshot; the function does not
+ * block, nor does it involve any IPC.
+ *
+ * Return value: %TRUE if @snapshot was filled in, %FALSE if no consistent
+ * copy could be obtained (i.e., the Toolbar was continually updating the
+ * state while we tried); the state is also not valid unless the flags of
+ * the snapshot include %MPL_TOOLBAR_STATE_RUNNING.
+ */
+gboolean
+mpl_toolbar_state_read (MplToolbarState         *state,
+                        MplToolbarStateSnapshot *snapshot)
+{
+  const MplToolbarStateSegment *segment;
+  gint                          i;
+
+  g_return_val_if_fail (state && snapshot, FALSE);
+
+  segment = state->segment;
+
+  for (i = 0; i < MAX_READ_ATTEMPTS; i++)
+    {
+      gint sequence = g_atomic_int_get ((volatile gint *) &segment->sequence);
+
+      if (sequence & 1)
+        continue;
+
+      memcpy (snapshot, &segment->snapshot, sizeof (MplToolbarStateSnapshot));
+
+      if (g_atomic_int_get ((volatile gint *) &segment->sequence) == sequence)
+        {
+          guint j;
+
+          if (snapshot->n_panels > MPL_TOOLBAR_STATE_MAX_PANELS)
+            snapshot->n_panels = MPL_TOOLBAR_STATE_MAX_PANELS;
+
+          /*
+           * Do not rely on the writer to have terminated the strings.
+           */
+          for (j = 0; j < snapshot->n_panels; j++)
+            {
+              MplToolbarStatePanel *panel = &snapshot->panels[j];
+
+              panel->name[MPL_TOOLBAR_STATE_STRING_SIZE - 1]         = '\0';
+              panel->tooltip[MPL_TOOLBAR_STATE_STRING_SIZE - 1]      = '\0';
+              panel->button_style[MPL_TOOLBAR_STATE_STRING_SIZE - 1] = '\0';
+            }
+
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
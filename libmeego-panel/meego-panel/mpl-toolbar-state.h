@@ -0,0 +1,167 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mpl-toolbar-state.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _MPL_TOOLBAR_STATE
+#define _MPL_TOOLBAR_STATE
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * MPL_TOOLBAR_STATE_SHM_NAME:
+ *
+ * Prefix of the name of the POSIX shared memory object the Toolbar publishes
+ * its state in; the full name is the prefix followed by '-' and the uid of
+ * the user.
+ */
+#define MPL_TOOLBAR_STATE_SHM_NAME      "/meego-toolbar-state"
+
+/**
+ * MPL_TOOLBAR_STATE_MAGIC:
+ *
+ * Magic number identifying the Toolbar state segment.
+ */
+#define MPL_TOOLBAR_STATE_MAGIC         0x4d544253
+
+/**
+ * MPL_TOOLBAR_STATE_VERSION:
+ *
+ * Version of the layout of the Toolbar state segment; bumped whenever the
+ * layout changes incompatibly.
+ */
+#define MPL_TOOLBAR_STATE_VERSION       1
+
+/**
+ * MPL_TOOLBAR_STATE_MAX_PANELS:
+ *
+ * Maximum number of panels described by the Toolbar state.
+ */
+#define MPL_TOOLBAR_STATE_MAX_PANELS    32
+
+/**
+ * MPL_TOOLBAR_STATE_STRING_SIZE:
+ *
+ * Size of the string fields in #MplToolbarStatePanel, including the
+ * terminating nul; longer strings are truncated.
+ */
+#define MPL_TOOLBAR_STATE_STRING_SIZE   128
+
+/**
+ * MplToolbarStateFlags:
+ * @MPL_TOOLBAR_STATE_RUNNING: the Toolbar is running, and the state current
+ * @MPL_TOOLBAR_STATE_VISIBLE: the Toolbar is visible
+ *
+ * Flags describing the Toolbar.
+ */
+typedef enum
+{
+  MPL_TOOLBAR_STATE_RUNNING = 0x1,
+  MPL_TOOLBAR_STATE_VISIBLE = 0x2
+} MplToolbarStateFlags;
+
+/**
+ * MplToolbarPanelStateFlags:
+ * @MPL_TOOLBAR_PANEL_STATE_LOADED: the panel process is running
+ * @MPL_TOOLBAR_PANEL_STATE_VISIBLE: the panel is showing
+ * @MPL_TOOLBAR_PANEL_STATE_MODAL: the panel is modal
+ * @MPL_TOOLBAR_PANEL_STATE_WINDOWLESS: the panel consists of a button only
+ * @MPL_TOOLBAR_PANEL_STATE_UNRESPONSIVE: the panel is not responding
+ *
+ * Flags describing a panel.
+ */
+typedef enum
+{
+  MPL_TOOLBAR_PANEL_STATE_LOADED       = 0x1,
+  MPL_TOOLBAR_PANEL_STATE_VISIBLE      = 0x2,
+  MPL_TOOLBAR_PANEL_STATE_MODAL        = 0x4,
+  MPL_TOOLBAR_PANEL_STATE_WINDOWLESS   = 0x8,
+  MPL_TOOLBAR_PANEL_STATE_UNRESPONSIVE = 0x10
+} MplToolbarPanelStateFlags;
+
+/**
+ * MplToolbarStatePanel:
+ * @name: canonical name of the panel
+ * @tooltip: tooltip of the panel button
+ * @button_style: style id of the panel button
+ * @flags: #MplToolbarPanelStateFlags
+ * @x: x coordinate of the panel
+ * @y: y coordinate of the panel
+ * @width: width of the panel
+ * @height: height of the panel
+ *
+ * State of a single panel; the geometry is only valid for loaded panels.
+ */
+typedef struct
+{
+  gchar   name[MPL_TOOLBAR_STATE_STRING_SIZE];
+  gchar   tooltip[MPL_TOOLBAR_STATE_STRING_SIZE];
+  gchar   button_style[MPL_TOOLBAR_STATE_STRING_SIZE];
+  guint32 flags;
+  gint32  x;
+  gint32  y;
+  guint32 width;
+  guint32 height;
+} MplToolbarStatePanel;
+
+/**
+ * MplToolbarStateSnapshot:
+ * @flags: #MplToolbarStateFlags
+ * @active_panel: index of the showing panel in @panels, or -1
+ * @n_panels: number of valid entries in @panels
+ * @panels: the panels, in the Toolbar order
+ *
+ * Consistent snapshot of the Toolbar state.
+ */
+typedef struct
+{
+  guint32              flags;
+  gint32               active_panel;
+  guint32              n_panels;
+  MplToolbarStatePanel panels[MPL_TOOLBAR_STATE_MAX_PANELS];
+} MplToolbarStateSnapshot;
+
+/*
+ * Layout of the shared memory segment. The Toolbar is the only writer; the
+ * sequence is odd while an update is in progress, so readers copy the
+ * snapshot, and retry if the sequence changed in the meantime (a seqlock).
+ */
+typedef struct
+{
+  guint32                 magic;
+  guint32                 version;
+  volatile gint           sequence;
+  guint32                 size;
+  MplToolbarStateSnapshot snapshot;
+} MplToolbarStateSegment;
+
+typedef struct _MplToolbarState MplToolbarState;
+
+MplToolbarState *mpl_toolbar_state_open         (void);
+void             mpl_toolbar_state_close        (MplToolbarState         *state);
+guint            mpl_toolbar_state_get_sequence (MplToolbarState         *state);
+gboolean         mpl_toolbar_state_read         (MplToolbarState         *state,
+                                                 MplToolbarStateSnapshot *snapshot);
+
+G_END_DECLS
+
+#endif
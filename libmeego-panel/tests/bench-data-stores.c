@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Benchmark for the on-disk data stores of libmeego-panel.
+ *
+ * Runs headless, no X server or D-Bus session required. All files are
+ * created in a scratch directory which is removed afterwards. Results are
+ * printed as tab separated values, one line per measurement:
+ *
+ *   <store> <operation> <n-entries> <total-usec> <usec-per-op> <peak-rss-kb>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <glib/gstdio.h>
+#include <meego-panel/mpl-app-bookmark-manager.h>
+#include <meego-panel/mpl-app-launches-query.h>
+#include <meego-panel/mpl-app-launches-store.h>
+
+/* Removal from the bookmark manager is linear in the number of bookmarks,
+ * only remove a sample. */
+#define BOOKMARK_REMOVALS_MAX 1000
+
+typedef struct
+{
+  char const  *scratch_dir;
+  unsigned    *sizes;
+  unsigned     n_sizes;
+  GMainLoop   *loop;
+  int          ret;
+} BenchData;
+
+static long
+peak_rss_kb (void)
+{
+  struct rusage usage;
+
+  if (0 != getrusage (RUSAGE_SELF, &usage))
+    return -1;
+
+  return usage.ru_maxrss;
+}
+
+static void
+report (char const  *store,
+        char const  *operation,
+        unsigned     n_entries,
+        unsigned     n_ops,
+        GTimer      *timer)
+{
+  double usec = g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC;
+
+  printf ("%s\t%s\t%u\t%.0f\t%.3f\t%li\n",
+          store, operation, n_entries,
+          usec, n_ops ? usec / n_ops : 0.0,
+          peak_rss_kb ());
+  fflush (stdout);
+}
+
+static char *
+executable_name (unsigned i)
+{
+  return g_strdup_printf ("/usr/bin/bench-app-%u", i);
+}
+
+static void
+remove_file (char const *path)
+{
+  if (g_file_test (path, G_FILE_TEST_EXISTS) &&
+      0 != g_unlink (path))
+  {
+    g_warning ("%s : Could not remove %s", G_STRLOC, path);
+  }
+}
+
+static bool
+bench_app_launches_store (BenchData *data,
+                          unsigned   n_entries)
+{
+  MplAppLaunchesStore   *store;
+  MplAppLaunchesQuery   *query;
+  MplAppLaunchesResult  *results;
+  char                 **executables;
+  char                  *database_file;
+  char                  *journal_file;
+  GTimer                *timer;
+  unsigned               n_found = 0;
+  unsigned               i;
+  GError                *error = NULL;
+
+  database_file = g_build_filename (data->scratch_dir, "app-launches", NULL);
+  journal_file = g_strconcat (database_file, ".journal", NULL);
+
+  store = g_object_new (MPL_TYPE_APP_LAUNCHES_STORE,
+                        "database-file", database_file,
+                        NULL);
+
+  executables = g_new0 (char *, n_entries + 1);
+  for (i = 0; i < n_entries; i++)
+  {
+    executables[i] = executable_name (i);
+  }
+
+  timer = g_timer_new ();
+
+  /* Synchronous add, one locked write per launch. */
+  g_timer_start (timer);
+  for (i = 0; i < n_entries && !error; i++)
+  {
+    mpl_app_launches_store_add (store, executables[i], 0, &error);
+  }
+  g_timer_stop (timer);
+  if (error)
+    goto bail;
+  report ("app-launches", "add", n_entries, n_entries, timer);
+
+  /* Queued add, written in one go by the flush ("save"). */
+  g_timer_start (timer);
+  for (i = 0; i < n_entries && !error; i++)
+  {
+    mpl_app_launches_store_add_async (store, executables[i], 0, &error);
+  }
+  g_timer_stop (timer);
+  if (error)
+    goto bail;
+  report ("app-launches", "add-async", n_entries, n_entries, timer);
+
+  g_timer_start (timer);
+  mpl_app_launches_store_flush (store, &error);
+  g_timer_stop (timer);
+  if (error)
+    goto bail;
+  report ("app-launches", "save", n_entries, 1, timer);
+
+  /* Single lookups, each one opens and maps the store. */
+  g_timer_start (timer);
+  for (i = 0; i < n_entries && !error; i++)
+  {
+    mpl_app_launches_store_lookup (store, executables[i], NULL, NULL, &error);
+  }
+  g_timer_stop (timer);
+  if (error)
+    goto bail;
+  report ("app-launches", "lookup", n_entries, n_entries, timer);
+
+  /* Opening a query maps the store and reads the journal. */
+  g_timer_start (timer);
+  query = mpl_app_launches_store_create_query (store);
+  g_timer_stop (timer);
+  report ("app-launches", "load", n_entries, 1, timer);
+
+  results = g_new0 (MplAppLaunchesResult, n_entries);
+  g_timer_start (timer);
+  mpl_app_launches_query_lookup_many (query,
+                                      (char const * const *) executables,
+                                      n_entries,
+                                      results,
+                                      &n_found,
+                                      &error);
+  g_timer_stop (timer);
+  if (!error)
+  {
+    report ("app-launches", "batch-lookup", n_entries, n_entries, timer);
+    if (n_found != n_entries)
+    {
+      g_warning ("%s : Found %u of %u entries", G_STRLOC, n_found, n_entries);
+      data->ret = EXIT_FAILURE;
+    }
+  }
+
+  if (!error)
+  {
+    unsigned n_results = MIN (n_entries, 10);
+    g_timer_start (timer);
+    mpl_app_launches_query_get_top (query,
+                                    MPL_APP_LAUNCHES_QUERY_MOST_FREQUENT,
+                                    n_results,
+                                    results,
+                                    &n_found,
+                                    &error);
+    g_timer_stop (timer);
+    if (!error)
+      report ("app-launches", "top-10", n_entries, 1, timer);
+  }
+
+  g_free (results);
+  g_object_unref (query);
+
+bail:
+  if (error)
+  {
+    g_critical ("%s\n\t%s", G_STRLOC, error->message);
+    g_clear_error (&error);
+    data->ret = EXIT_FAILURE;
+  }
+
+  g_timer_destroy (timer);
+  g_strfreev (executables);
+  g_object_unref (store);
+
+  remove_file (database_file);
+  remove_file (journal_file);
+  g_free (database_file);
+  g_free (journal_file);
+
+  return EXIT_SUCCESS == data->ret;
+}
+
+static bool
+bench_app_bookmark_manager (BenchData *data,
+                            unsigned   n_entries)
+{
+  MplAppBookmarkManager *manager;
+  GTimer                *timer;
+  GList                 *bookmarks;
+  char                  *bookmarks_file;
+  unsigned               n_removals;
+  unsigned               i;
+
+  /* The manager keeps its bookmarks in the user data directory, which
+   * has been pointed at the scratch directory. */
+  bookmarks_file = g_build_filename (g_get_user_data_dir (),
+                                     "favourite-apps", NULL);
+  g_file_set_contents (bookmarks_file, "", 0, NULL);
+
+  manager = g_object_new (MPL_TYPE_APP_BOOKMARK_MANAGER, NULL);
+
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < n_entries; i++)
+  {
+    char *uri = g_strdup_printf ("file:///usr/share/applications/bench-app-%u.desktop", i);
+    mpl_app_bookmark_manager_add_uri (manager, uri);
+    g_free (uri);
+  }
+  g_timer_stop (timer);
+  report ("app-bookmarks", "add", n_entries, n_entries, timer);
+
+  g_timer_start (timer);
+  mpl_app_bookmark_manager_save (manager);
+  g_timer_stop (timer);
+  report ("app-bookmarks", "save", n_entries, 1, timer);
+
+  g_object_unref (manager);
+
+  g_timer_start (timer);
+  manager = g_object_new (MPL_TYPE_APP_BOOKMARK_MANAGER, NULL);
+  g_timer_stop (timer);
+  report ("app-bookmarks", "load", n_entries, 1, timer);
+
+  bookmarks = mpl_app_bookmark_manager_get_bookmarks (manager);
+  if (g_list_length (bookmarks) != n_entries)
+  {
+    g_warning ("%s : Loaded %u of %u bookmarks",
+               G_STRLOC, g_list_length (bookmarks), n_entries);
+    data->ret = EXIT_FAILURE;
+  }
+  g_list_free (bookmarks);
+
+  n_removals = MIN (n_entries, BOOKMARK_REMOVALS_MAX);
+  g_timer_start (timer);
+  for (i = 0; i < n_removals; i++)
+  {
+    char *uri = g_strdup_printf ("file:///usr/share/applications/bench-app-%u.desktop", i);
+    mpl_app_bookmark_manager_remove_uri (manager, uri);
+    g_free (uri);
+  }
+  g_timer_stop (timer);
+  report ("app-bookmarks", "remove", n_entries, n_removals, timer);
+
+  /* Write the removals now, rather than from dispose. */
+  mpl_app_bookmark_manager_save (manager);
+
+  g_timer_destroy (timer);
+  g_object_unref (manager);
+
+  remove_file (bookmarks_file);
+  g_free (bookmarks_file);
+
+  return EXIT_SUCCESS == data->ret;
+}
+
+static gboolean
+_run_cb (BenchData *data)
+{
+  unsigned i;
+
+  /* Run from the main loop, so that queued launches are batched like
+   * they are in the panels. */
+  printf ("# store\toperation\tentries\ttotal-usec\tusec-per-op\tpeak-rss-kb\n");
+
+  for (i = 0; i < data->n_sizes; i++)
+  {
+    if (!bench_app_launches_store (data, data->sizes[i]))
+      break;
+
+    if (!bench_app_bookmark_manager (data, data->sizes[i]))
+      break;
+  }
+
+  g_main_loop_quit (data->loop);
+
+  return FALSE;
+}
+
+static unsigned *
+parse_sizes (char const *sizes_str,
+             unsigned   *n_sizes_out)
+{
+  char      **tokens;
+  unsigned   *sizes;
+  unsigned    i;
+
+  tokens = g_strsplit (sizes_str, ",", -1);
+  sizes = g_new0 (unsigned, g_strv_length (tokens));
+
+  for (i = 0; tokens[i]; i++)
+  {
+    sizes[i] = strtoul (tokens[i], NULL, 10);
+  }
+
+  *n_sizes_out = i;
+  g_strfreev (tokens);
+
+  return sizes;
+}
+
+int
+main (int     argc,
+      char  **argv)
+{
+  char const *sizes_str = "10,1000,100000";
+  GOptionEntry _options[] = {
+    { "sizes", 's', 0, G_OPTION_ARG_STRING, (void **) &sizes_str,
+      "Comma separated list of entry counts to run with, "
+      "default is 10,1000,100000", "<n>,..." },
+    { NULL }
+  };
+
+  GOptionContext  *context;
+  BenchData        data = { 0, };
+  char            *scratch_dir;
+  GError          *error = NULL;
+
+  g_type_init ();
+
+  context = g_option_context_new ("- Benchmark libmeego-panel data stores");
+  g_option_context_add_main_entries (context, _options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+  {
+    g_critical ("%s\n\t%s", G_STRLOC, error->message);
+    g_clear_error (&error);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (context);
+
+  scratch_dir = g_build_filename (g_get_tmp_dir (),
+                                  "bench-data-stores-XXXXXX", NULL);
+  if (NULL == mkdtemp (scratch_dir))
+  {
+    g_critical ("%s : Could not create %s", G_STRLOC, scratch_dir);
+    return EXIT_FAILURE;
+  }
+
+  /* Keep the user's real data out of this, must happen before anything
+   * queries the user data directory. */
+  g_setenv ("XDG_DATA_HOME", scratch_dir, true);
+
+  data.scratch_dir = scratch_dir;
+  data.sizes = parse_sizes (sizes_str, &data.n_sizes);
+  data.loop = g_main_loop_new (NULL, false);
+  data.ret = EXIT_SUCCESS;
+
+  g_idle_add ((GSourceFunc) _run_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_main_loop_unref (data.loop);
+  g_free (data.sizes);
+
+  if (0 != g_rmdir (scratch_dir))
+  {
+    g_warning ("%s : Could not remove %s", G_STRLOC, scratch_dir);
+  }
+  g_free (scratch_dir);
+
+  return data.ret;
+}
@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Benchmark for the panel D-Bus protocol.
+ *
+ * Runs headless, no X server or compositor required: a private D-Bus daemon
+ * is started, this process acts as a mock Toolbar implementing
+ * mnb-toolbar-dbus.xml, and spawns itself with --panel as a windowless
+ * panel. The Toolbar then drives the panel through InitPanel, show/hide
+ * cycles and Unload, restarting it a number of times.
+ *
+ * Results are printed as tab separated values. Round trips, one line per
+ * method (startup is spawn to the panel name appearing on the bus, exit
+ * is Unload to the panel process terminating):
+ *
+ *   call <method> <n-calls> <total-usec> <usec-per-call> <max-usec>
+ *
+ * Memory, one line per restart (warm is after the first show/hide cycle),
+ * growth of the panel over the cycles points to a leak in MplPanelClient:
+ *
+ *   rss <process> <restart> <warm-kb> <end-kb>
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-bindings.h>
+#include <meego-panel/mpl-panel-common.h>
+#include <meego-panel/mpl-panel-windowless.h>
+#include <meego-panel/mnb-panel-dbus-bindings.h>
+
+#define PANEL_NAME "bench"
+
+/* How long to wait for the panel to appear on the bus or to exit. */
+#define PANEL_TIMEOUT_USEC (10 * G_USEC_PER_SEC)
+
+typedef enum
+{
+  CALL_STARTUP = 0,
+  CALL_INIT_PANEL,
+  CALL_SET_GEOMETRY,
+  CALL_SHOW,
+  CALL_SHOW_BEGIN,
+  CALL_SHOW_END,
+  CALL_HIDE,
+  CALL_HIDE_BEGIN,
+  CALL_HIDE_END,
+  CALL_UNLOAD,
+  CALL_EXIT,
+
+  N_CALLS
+} Call;
+
+static char const *call_names[N_CALLS] = {
+  "startup",
+  "InitPanel",
+  "SetGeometry",
+  "Show",
+  "ShowBegin",
+  "ShowEnd",
+  "Hide",
+  "HideBegin",
+  "HideEnd",
+  "Unload",
+  "exit"
+};
+
+typedef struct
+{
+  unsigned  count;
+  double    total;
+  double    max;
+} CallStats;
+
+typedef struct
+{
+  DBusGConnection *conn;
+  DBusGProxy      *bus_proxy;
+  GTimer          *timer;
+  CallStats        stats[N_CALLS];
+} BenchData;
+
+/*
+ * Mock Toolbar.
+ */
+
+typedef struct
+{
+  GObject parent;
+} MockToolbar;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} MockToolbarClass;
+
+static GType mock_toolbar_get_type (void);
+
+G_DEFINE_TYPE (MockToolbar, mock_toolbar, G_TYPE_OBJECT)
+
+static gboolean
+mnb_toolbar_dbus_show_toolbar (MockToolbar  *self,
+                               GError      **error)
+{
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_hide_toolbar (MockToolbar  *self,
+                               GError      **error)
+{
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_show_panel (MockToolbar  *self,
+                             gchar        *name,
+                             GError      **error)
+{
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_hide_panel (MockToolbar  *self,
+                             gchar        *name,
+                             gboolean      hide_toolbar,
+                             GError      **error)
+{
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_paint_profile (MockToolbar  *self,
+                                    gboolean      reset,
+                                    gchar       **profile,
+                                    GError      **error)
+{
+  *profile = g_strdup ("");
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_startup_trace (MockToolbar  *self,
+                                    gchar       **trace,
+                                    GError      **error)
+{
+  *trace = g_strdup ("");
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_show_latency (MockToolbar  *self,
+                                   gchar       **latency,
+                                   GError      **error)
+{
+  *latency = g_strdup ("");
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_panel_usage (MockToolbar  *self,
+                                  gchar       **usage,
+                                  GError      **error)
+{
+  *usage = g_strdup ("");
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_panel_health (MockToolbar  *self,
+                                   gchar       **health,
+                                   GError      **error)
+{
+  *health = g_strdup ("");
+  return TRUE;
+}
+
+#include <meego-panel/mnb-toolbar-dbus-glue.h>
+
+static void
+mock_toolbar_class_init (MockToolbarClass *klass)
+{
+  dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (klass),
+                                   &dbus_glib_mnb_toolbar_dbus_object_info);
+}
+
+static void
+mock_toolbar_init (MockToolbar *self)
+{
+}
+
+/*
+ * Panel side, runs in the child process.
+ */
+
+static void
+_panel_unload_cb (MplPanelClient  *panel,
+                  GMainLoop       *loop)
+{
+  /* The default handler of MplPanelWindowless does not know our loop. */
+  g_signal_stop_emission_by_name (panel, "unload");
+  g_main_loop_quit (loop);
+}
+
+static int
+run_panel (void)
+{
+  MplPanelClient  *panel;
+  DBusGConnection *conn;
+  GMainLoop       *loop;
+
+  loop = g_main_loop_new (NULL, false);
+
+  panel = mpl_panel_windowless_new (PANEL_NAME, "bench", "", "bench-button",
+                                    true);
+  g_signal_connect (panel, "unload", G_CALLBACK (_panel_unload_cb), loop);
+
+  g_main_loop_run (loop);
+
+  /* Make sure the Unload reply gets out before we go. */
+  conn = dbus_g_bus_get (DBUS_BUS_SESSION, NULL);
+  if (conn)
+  {
+    dbus_connection_flush (dbus_g_connection_get_connection (conn));
+    dbus_g_connection_unref (conn);
+  }
+
+  g_object_unref (panel);
+  g_main_loop_unref (loop);
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Toolbar side.
+ */
+
+static long
+process_rss_kb (GPid pid)
+{
+  char  *path;
+  char  *contents = NULL;
+  long   pages = 0;
+
+  path = g_strdup_printf ("/proc/%d/statm", pid);
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+  {
+    sscanf (contents, "%*u %ld", &pages);
+  }
+  g_free (contents);
+  g_free (path);
+
+  return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+record (BenchData *data,
+        Call       call,
+        double     start)
+{
+  double usec = (g_timer_elapsed (data->timer, NULL) - start) *
+                G_USEC_PER_SEC;
+
+  data->stats[call].count++;
+  data->stats[call].total += usec;
+  if (usec > data->stats[call].max)
+    data->stats[call].max = usec;
+}
+
+static bool
+start_private_bus (GPid *pid_out)
+{
+  char    *argv[] = { "dbus-daemon", "--session", "--fork",
+                      "--print-address=1", "--print-pid=1", NULL };
+  char    *output = NULL;
+  char   **lines;
+  GError  *error = NULL;
+  bool     ret = false;
+
+  if (!g_spawn_sync (NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+                     &output, NULL, NULL, &error))
+  {
+    g_critical ("%s : Could not start dbus-daemon: %s",
+                G_STRLOC, error->message);
+    g_clear_error (&error);
+    return false;
+  }
+
+  lines = g_strsplit (output, "\n", 3);
+  if (lines[0] && *lines[0] && lines[1] && *lines[1])
+  {
+    g_setenv ("DBUS_SESSION_BUS_ADDRESS", lines[0], true);
+    *pid_out = atoi (lines[1]);
+    ret = true;
+  } else {
+    g_critical ("%s : Unexpected dbus-daemon output '%s'", G_STRLOC, output);
+  }
+
+  g_strfreev (lines);
+  g_free (output);
+
+  return ret;
+}
+
+static bool
+wait_for_panel (BenchData *data,
+                bool       present)
+{
+  double   start = g_timer_elapsed (data->timer, NULL);
+  gboolean has_owner = !present;
+  GError  *error = NULL;
+
+  while (has_owner != present)
+  {
+    if (!org_freedesktop_DBus_name_has_owner (data->bus_proxy,
+                                              MPL_PANEL_DBUS_NAME_PREFIX
+                                              PANEL_NAME,
+                                              &has_owner, &error))
+    {
+      g_critical ("%s : %s", G_STRLOC, error->message);
+      g_clear_error (&error);
+      return false;
+    }
+
+    if (has_owner != present)
+    {
+      if ((g_timer_elapsed (data->timer, NULL) - start) * G_USEC_PER_SEC >
+          PANEL_TIMEOUT_USEC)
+      {
+        g_critical ("%s : Timed out waiting for the panel", G_STRLOC);
+        return false;
+      }
+      g_usleep (1000);
+    }
+  }
+
+  return true;
+}
+
+#define TIMED_CALL(data_, call_, expr_)                 \
+  G_STMT_START {                                        \
+    double start_ = g_timer_elapsed (data_->timer, NULL); \
+    if (!(expr_))                                       \
+      goto bail;                                        \
+    record (data_, call_, start_);                      \
+  } G_STMT_END
+
+static bool
+run_restart (BenchData  *data,
+             char const *self_path,
+             unsigned    restart,
+             unsigned    n_cycles)
+{
+  char        *argv[] = { (char *) self_path, "--panel", NULL };
+  DBusGProxy  *proxy;
+  GPid         pid;
+  char        *name = NULL;
+  guint        xid;
+  char        *tooltip = NULL;
+  char        *stylesheet = NULL;
+  char        *button_style = NULL;
+  guint        alloc_width, alloc_height;
+  long         warm_rss = 0;
+  double       start;
+  int          status;
+  unsigned     i;
+  GError      *error = NULL;
+
+  start = g_timer_elapsed (data->timer, NULL);
+  if (!g_spawn_async (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                      NULL, NULL, &pid, &error))
+  {
+    g_critical ("%s : %s", G_STRLOC, error->message);
+    g_clear_error (&error);
+    return false;
+  }
+
+  if (!wait_for_panel (data, true))
+  {
+    kill (pid, SIGKILL);
+    waitpid (pid, NULL, 0);
+    return false;
+  }
+  record (data, CALL_STARTUP, start);
+
+  proxy = dbus_g_proxy_new_for_name (data->conn,
+                                     MPL_PANEL_DBUS_NAME_PREFIX PANEL_NAME,
+                                     MPL_PANEL_DBUS_PATH_PREFIX PANEL_NAME,
+                                     MPL_PANEL_DBUS_INTERFACE);
+
+  TIMED_CALL (data, CALL_INIT_PANEL,
+              com_meego_UX_Shell_Panel_init_panel (proxy, 0, 0, 1024, 600,
+                                                   &name, &xid, &tooltip,
+                                                   &stylesheet, &button_style,
+                                                   &alloc_width,
+                                                   &alloc_height, &error));
+
+  for (i = 0; i < n_cycles; i++)
+  {
+    /* Same sequence of calls the Toolbar makes for a panel show/hide. */
+    TIMED_CALL (data, CALL_SET_GEOMETRY,
+                com_meego_UX_Shell_Panel_set_geometry (proxy, 0, i % 2,
+                                                       1024, 600, &error));
+    TIMED_CALL (data, CALL_SHOW,
+                com_meego_UX_Shell_Panel_show (proxy, &error));
+    TIMED_CALL (data, CALL_SHOW_BEGIN,
+                com_meego_UX_Shell_Panel_show_begin (proxy, &error));
+    TIMED_CALL (data, CALL_SHOW_END,
+                com_meego_UX_Shell_Panel_show_end (proxy, &error));
+    TIMED_CALL (data, CALL_HIDE,
+                com_meego_UX_Shell_Panel_hide (proxy, &error));
+    TIMED_CALL (data, CALL_HIDE_BEGIN,
+                com_meego_UX_Shell_Panel_hide_begin (proxy, &error));
+    TIMED_CALL (data, CALL_HIDE_END,
+                com_meego_UX_Shell_Panel_hide_end (proxy, &error));
+
+    if (i == 0)
+    {
+      warm_rss = process_rss_kb (pid);
+    }
+  }
+
+  printf ("rss\tpanel\t%u\t%li\t%li\n", restart, warm_rss,
+          process_rss_kb (pid));
+  fflush (stdout);
+
+  TIMED_CALL (data, CALL_UNLOAD,
+              com_meego_UX_Shell_Panel_unload (proxy, &error));
+
+  start = g_timer_elapsed (data->timer, NULL);
+  if (waitpid (pid, &status, 0) < 0 ||
+      !WIFEXITED (status) ||
+      WEXITSTATUS (status) != EXIT_SUCCESS)
+  {
+    g_critical ("%s : Panel process did not exit cleanly", G_STRLOC);
+    pid = 0;
+    goto bail;
+  }
+  record (data, CALL_EXIT, start);
+  g_spawn_close_pid (pid);
+
+  /* The name has to be gone before the next panel can take it. */
+  if (!wait_for_panel (data, false))
+  {
+    pid = 0;
+    goto bail;
+  }
+
+  g_free (name);
+  g_free (tooltip);
+  g_free (stylesheet);
+  g_free (button_style);
+  g_object_unref (proxy);
+
+  return true;
+
+bail:
+  if (error)
+  {
+    g_critical ("%s : %s", G_STRLOC, error->message);
+    g_clear_error (&error);
+  }
+  if (pid)
+  {
+    kill (pid, SIGKILL);
+    waitpid (pid, NULL, 0);
+  }
+  g_free (name);
+  g_free (tooltip);
+  g_free (stylesheet);
+  g_free (button_style);
+  g_object_unref (proxy);
+
+  return false;
+}
+
+int
+main (int     argc,
+      char  **argv)
+{
+  int       n_cycles = 1000;
+  int       n_restarts = 10;
+  gboolean  panel_mode = false;
+  gboolean  session_bus = false;
+  GOptionEntry _options[] = {
+    { "cycles", 'c', 0, G_OPTION_ARG_INT, &n_cycles,
+      "Number of show/hide cycles per panel run, default is 1000", "<n>" },
+    { "restarts", 'r', 0, G_OPTION_ARG_INT, &n_restarts,
+      "Number of times to start the panel, default is 10", "<n>" },
+    { "session-bus", 's', 0, G_OPTION_ARG_NONE, &session_bus,
+      "Use the existing session bus instead of a private one", NULL },
+    { "panel", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &panel_mode,
+      "Run as the panel (internal)", NULL },
+    { NULL }
+  };
+
+  GOptionContext  *context;
+  BenchData        data = { 0, };
+  MockToolbar     *toolbar;
+  GPid             bus_pid = 0;
+  guint            status;
+  long             warm_rss = 0;
+  unsigned         i;
+  int              ret = EXIT_SUCCESS;
+  GError          *error = NULL;
+
+  g_type_init ();
+
+  context = g_option_context_new ("- Benchmark the panel D-Bus protocol");
+  g_option_context_add_main_entries (context, _options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+  {
+    g_critical ("%s\n\t%s", G_STRLOC, error->message);
+    g_clear_error (&error);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (context);
+
+  if (panel_mode)
+    return run_panel ();
+
+  /* Must happen before anything connects to the session bus. */
+  if (!session_bus && !start_private_bus (&bus_pid))
+    return EXIT_FAILURE;
+
+  data.conn = dbus_g_bus_get (DBUS_BUS_SESSION, &error);
+  if (!data.conn)
+  {
+    g_critical ("%s : %s", G_STRLOC, error->message);
+    g_clear_error (&error);
+    ret = EXIT_FAILURE;
+    goto out;
+  }
+
+  data.bus_proxy = dbus_g_proxy_new_for_name (data.conn,
+                                              DBUS_SERVICE_DBUS,
+                                              DBUS_PATH_DBUS,
+                                              DBUS_INTERFACE_DBUS);
+
+  if (!org_freedesktop_DBus_request_name (data.bus_proxy,
+                                          MPL_TOOLBAR_DBUS_NAME,
+                                          DBUS_NAME_FLAG_DO_NOT_QUEUE,
+                                          &status, &error) ||
+      status != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER)
+  {
+    g_critical ("%s : Could not acquire %s, is a Toolbar running?",
+                G_STRLOC, MPL_TOOLBAR_DBUS_NAME);
+    g_clear_error (&error);
+    ret = EXIT_FAILURE;
+    goto out;
+  }
+
+  toolbar = g_object_new (mock_toolbar_get_type (), NULL);
+  dbus_g_connection_register_g_object (data.conn, MPL_TOOLBAR_DBUS_PATH,
+                                       G_OBJECT (toolbar));
+
+  data.timer = g_timer_new ();
+
+  for (i = 0; i < (unsigned) n_restarts; i++)
+  {
+    if (!run_restart (&data, argv[0], i, n_cycles))
+    {
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    if (i == 0)
+    {
+      warm_rss = process_rss_kb (getpid ());
+    }
+  }
+
+  for (i = 0; i < N_CALLS; i++)
+  {
+    CallStats *stats = &data.stats[i];
+
+    printf ("call\t%s\t%u\t%.0f\t%.3f\t%.0f\n",
+            call_names[i], stats->count, stats->total,
+            stats->count ? stats->total / stats->count : 0.0,
+            stats->max);
+  }
+
+  printf ("rss\ttoolbar\t%d\t%li\t%li\n", n_restarts, warm_rss,
+          process_rss_kb (getpid ()));
+
+  g_timer_destroy (data.timer);
+  g_object_unref (toolbar);
+
+out:
+  if (data.bus_proxy)
+  {
+    g_object_unref (data.bus_proxy);
+  }
+  if (data.conn)
+  {
+    dbus_g_connection_unref (data.conn);
+  }
+  if (bus_pid)
+  {
+    kill (bus_pid, SIGTERM);
+  }
+
+  return ret;
+}
@@ -0,0 +1,102 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Test for panel sub-windows that map before the panel window does.
+ *
+ * The panel opens a dialog shortly after it has been initialized by the
+ * Toolbar, while the panel window itself is still unmapped. The Toolbar must
+ * recognize the dialog as belonging to the panel, so that:
+ *
+ *   - closing the dialog on an otherwise empty workspace does not trigger the
+ *     empty workspace handling, and
+ *
+ *   - when the panel is shown while the dialog is up, clicking into the
+ *     dialog does not hide the panel.
+ *
+ * To run, install test-panel-subwindow.service in place of
+ * test-panel-gtk.service (they both provide the test panel).
+ */
+
+#include <gtk/gtk.h>
+
+#include <meego-panel/mpl-panel-gtk.h>
+#include <meego-panel/mpl-panel-common.h>
+
+static gboolean
+show_dialog_cb (gpointer data)
+{
+  GtkWidget *dialog;
+
+  dialog = gtk_message_dialog_new (NULL, 0,
+                                   GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE,
+                                   "This dialog was mapped before the panel "
+                                   "window; it should be treated as part of "
+                                   "the test panel.");
+
+  g_signal_connect (dialog, "response", G_CALLBACK (gtk_widget_destroy), NULL);
+
+  gtk_widget_show (dialog);
+
+  return FALSE;
+}
+
+/*
+ * The first ::set-size is emitted from the InitPanel call; give the Toolbar a
+ * moment to process the reply, then open the dialog.
+ */
+static void
+set_size_cb (MplPanelClient *panel, guint width, guint height, gpointer data)
+{
+  static gboolean done = FALSE;
+
+  if (done)
+    return;
+
+  done = TRUE;
+
+  g_timeout_add (1000, show_dialog_cb, NULL);
+}
+
+int
+main (int argc, char *argv[])
+{
+  MplPanelClient *panel;
+  GtkWidget      *label;
+
+  gtk_init (&argc, &argv);
+
+  panel = mpl_panel_gtk_new (MPL_PANEL_TEST,           /* the panel slot */
+                             "test",                   /* tooltip */
+                             CSS_DIR"/test-panel.css", /*stylesheet */
+                             "state1",                 /* button style */
+                             FALSE);                   /* no toolbar service*/
+
+  label = gtk_label_new ("Sub-window test panel");
+  gtk_widget_show (label);
+  mpl_panel_gtk_set_child (MPL_PANEL_GTK (panel), label);
+
+  g_signal_connect (panel, "set-size", G_CALLBACK (set_size_cb), NULL);
+
+  gtk_main ();
+
+  return 0;
+}
@@ -23,12 +23,13 @@
  */
 #include <string.h>
 #include <clutter/x11/clutter-x11.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
 
 #include "mnb-alttab-overlay.h"
 #include "mnb-alttab-overlay-app.h"
 #include "penge-magic-texture.h"
 #include "../meego-netbook.h"
+#include "../mnb-icon-cache.h"
+#include "../mnb-thumbnail.h"
 
 #define MNB_SWICHER_APP_ICON_PADDING         5.0
 #define MNB_SWICHER_APP_ICON_SIZE           32.0
@@ -184,6 +185,54 @@ mnb_alttab_overlay_app_origin_weak_notify (gpointer data, GObject *obj)
   clutter_actor_destroy (self);
 }
 
+/*
+ * The apps are kept around between invocations of the overlay (see
+ * mnb_alttab_overlay_populate()), so we need to track changes to the window
+ * icon and title.
+ */
+static void
+mnb_alttab_overlay_app_update_icon (MnbAlttabOverlayApp *app)
+{
+  ClutterActor               *actor = CLUTTER_ACTOR (app);
+  MnbAlttabOverlayAppPrivate *priv  = app->priv;
+  MetaWindow                 *meta_win;
+
+  meta_win = mutter_window_get_meta_window (priv->mcw);
+
+  if (priv->icon)
+    {
+      clutter_actor_destroy (priv->icon);
+      priv->icon = NULL;
+    }
+
+  if ((priv->icon = mnb_icon_cache_get_icon (meta_win)))
+    {
+      clutter_actor_set_parent (priv->icon, actor);
+      clutter_actor_show (priv->icon);
+    }
+
+  clutter_actor_queue_relayout (actor);
+}
+
+static void
+mnb_alttab_overlay_app_icon_notify_cb (MetaWindow          *meta_win,
+                                       GParamSpec          *pspec,
+                                       MnbAlttabOverlayApp *app)
+{
+  mnb_alttab_overlay_app_update_icon (app);
+}
+
+static void
+mnb_alttab_overlay_app_title_notify_cb (MetaWindow          *meta_win,
+                                        GParamSpec          *pspec,
+                                        MnbAlttabOverlayApp *app)
+{
+  MnbAlttabOverlayAppPrivate *priv  = app->priv;
+  const gchar                *title = meta_window_get_title (meta_win);
+
+  clutter_text_set_text (CLUTTER_TEXT (priv->text), title ? title : "");
+}
+
 static void
 mnb_alttab_overlay_app_constructed (GObject *self)
 {
@@ -192,38 +241,22 @@ mnb_alttab_overlay_app_constructed (GObject *self)
   MetaWindow            *meta_win  = mutter_window_get_meta_window (priv->mcw);
   const gchar           *title     = meta_window_get_title (meta_win);
   ClutterActor          *texture, *c_tx;
-  GdkPixbuf             *pixbuf = NULL;
 
   if (G_OBJECT_CLASS (mnb_alttab_overlay_app_parent_class)->constructed)
     G_OBJECT_CLASS (mnb_alttab_overlay_app_parent_class)->constructed (self);
 
-  g_object_get (meta_win, "icon", &pixbuf, NULL);
-  if (pixbuf)
-    {
-      ClutterActor *icon = clutter_texture_new ();
-
-      clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (icon),
-                                         gdk_pixbuf_get_pixels (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf),
-                                         gdk_pixbuf_get_width (pixbuf),
-                                         gdk_pixbuf_get_height (pixbuf),
-                                         gdk_pixbuf_get_rowstride (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf) ? 4 : 3,
-                                         0, NULL);
-
-      clutter_actor_set_parent (icon, actor);
-      clutter_actor_show (icon);
-
-      priv->icon = icon;
-    }
+  mnb_alttab_overlay_app_update_icon (MNB_ALTTAB_OVERLAY_APP (self));
 
   /*
-   * Clone the glx texture in the MutterWindow, and insert it into ourselves.
+   * Insert a thumbnail of the MutterWindow into ourselves; the thumbnail
+   * only needs to be as large as our tile.
    */
   texture = mutter_window_get_texture (priv->mcw);
   g_object_set (texture, "keep-aspect-ratio", TRUE, NULL);
 
-  c_tx = priv->child = clutter_clone_new (texture);
+  c_tx = priv->child = mnb_thumbnail_new (priv->mcw,
+                                          MNB_ALTTAB_OVERLAY_TILE_WIDTH,
+                                          MNB_ALTTAB_OVERLAY_TILE_HEIGHT);
   clutter_actor_set_parent (c_tx, actor);
   clutter_actor_set_reactive (actor, TRUE);
 
@@ -240,6 +273,13 @@ mnb_alttab_overlay_app_constructed (GObject *self)
   if (priv->background)
     clutter_actor_set_parent (priv->background, actor);
 
+  g_signal_connect_object (meta_win, "notify::icon",
+                           G_CALLBACK (mnb_alttab_overlay_app_icon_notify_cb),
+                           self, 0);
+  g_signal_connect_object (meta_win, "notify::title",
+                           G_CALLBACK (mnb_alttab_overlay_app_title_notify_cb),
+                           self, 0);
+
   g_object_weak_ref (G_OBJECT (priv->mcw),
                      mnb_alttab_overlay_app_origin_weak_notify, self);
 }
@@ -35,6 +35,10 @@ struct _MnbAlttabOverlayPrivate
   MnbAlttabOverlayApp *active;
   ClutterActor        *grid;
 
+  GList               *mru;             /* MutterWindows, most recent first */
+  GHashTable          *apps;            /* MutterWindow -> MnbAlttabOverlayApp */
+  ClutterActor        *apps_background; /* background the apps were made with */
+
   gfloat               viewport_height;
   gfloat               scroll_y;
   guint                current_row;
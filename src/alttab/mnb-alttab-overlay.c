@@ -26,6 +26,7 @@
 #include "mnb-alttab-overlay-app.h"
 #include "mnb-alttab-keys.h"
 #include "../meego-netbook.h"
+#include "../mnb-paint-profiler.h"
 #include <display.h>
 #include <keybindings.h>
 #include <X11/keysym.h>
@@ -34,6 +35,11 @@
 #define PADDING 10
 
 static void mnb_alttab_stop_autoscroll (MnbAlttabOverlay *overlay);
+static void mnb_alttab_overlay_window_destroyed_cb (MutterWindow     *mcw,
+                                                    MnbAlttabOverlay *overlay);
+static void mnb_alttab_overlay_focus_window_notify_cb (MetaDisplay      *,
+                                                       GParamSpec       *,
+                                                       MnbAlttabOverlay *);
 
 enum
 {
@@ -51,13 +57,39 @@ G_DEFINE_TYPE (MnbAlttabOverlay, mnb_alttab_overlay, MX_TYPE_WIDGET);
 static void
 mnb_alttab_overlay_dispose (GObject *object)
 {
-  MnbAlttabOverlayPrivate *priv = MNB_ALTTAB_OVERLAY (object)->priv;
+  MnbAlttabOverlayPrivate *priv    = MNB_ALTTAB_OVERLAY (object)->priv;
+  MutterPlugin            *plugin  = meego_netbook_get_plugin_singleton ();
+  MetaScreen              *screen  = mutter_plugin_get_screen (plugin);
+  MetaDisplay             *display = meta_screen_get_display (screen);
 
   if (priv->disposed)
     return;
 
   priv->disposed = TRUE;
 
+  g_signal_handlers_disconnect_by_func (display,
+                                 mnb_alttab_overlay_focus_window_notify_cb,
+                                 object);
+
+  if (priv->mru)
+    {
+      GList *l;
+
+      for (l = priv->mru; l; l = l->next)
+        g_signal_handlers_disconnect_by_func (l->data,
+                                      mnb_alttab_overlay_window_destroyed_cb,
+                                      object);
+
+      g_list_free (priv->mru);
+      priv->mru = NULL;
+    }
+
+  if (priv->apps)
+    {
+      g_hash_table_destroy (priv->apps);
+      priv->apps = NULL;
+    }
+
   clutter_actor_destroy (priv->grid);
   priv->grid = NULL;
 
@@ -135,17 +167,86 @@ sort_windows_by_user_time (gconstpointer a, gconstpointer b)
   return 0;
 }
 
+/*
+ * The windows we might show in the overlay are kept in a MRU list, which is
+ * maintained incrementally: windows are inserted as they get mapped (ordered
+ * by their user time), moved to the front when they get focus, and removed
+ * when they are destroyed. The list is prefiltered by the window type, the
+ * rest of the conditions can change, so they are checked when the list is
+ * used.
+ */
+void
+mnb_alttab_overlay_track_window (MnbAlttabOverlay *overlay, MutterWindow *mcw)
+{
+  MnbAlttabOverlayPrivate *priv = overlay->priv;
+  MetaCompWindowType       type;
+
+  type = mutter_window_get_window_type (mcw);
+
+  if (type != META_COMP_WINDOW_NORMAL && type != META_COMP_WINDOW_DIALOG)
+    return;
+
+  if (g_list_find (priv->mru, mcw))
+    return;
+
+  priv->mru = g_list_insert_sorted (priv->mru, mcw, sort_windows_by_user_time);
+
+  g_signal_connect (mcw, "window-destroyed",
+                    G_CALLBACK (mnb_alttab_overlay_window_destroyed_cb),
+                    overlay);
+}
+
+static void
+mnb_alttab_overlay_window_destroyed_cb (MutterWindow     *mcw,
+                                        MnbAlttabOverlay *overlay)
+{
+  MnbAlttabOverlayPrivate *priv = overlay->priv;
+  MnbAlttabOverlayApp     *app;
+
+  g_signal_handlers_disconnect_by_func (mcw,
+                                        mnb_alttab_overlay_window_destroyed_cb,
+                                        overlay);
+
+  priv->mru = g_list_remove (priv->mru, mcw);
+
+  if ((app = g_hash_table_lookup (priv->apps, mcw)))
+    {
+      if (priv->active == app)
+        priv->active = NULL;
+
+      g_hash_table_remove (priv->apps, mcw);
+    }
+}
+
+static void
+mnb_alttab_overlay_focus_window_notify_cb (MetaDisplay      *display,
+                                           GParamSpec       *pspec,
+                                           MnbAlttabOverlay *overlay)
+{
+  MnbAlttabOverlayPrivate *priv = overlay->priv;
+  MetaWindow              *mw   = meta_display_get_focus_window (display);
+  MutterWindow            *mcw;
+  GList                   *l;
+
+  if (!mw)
+    return;
+
+  mcw = (MutterWindow*) meta_window_get_compositor_private (mw);
+
+  if (!mcw || !(l = g_list_find (priv->mru, mcw)) || l == priv->mru)
+    return;
+
+  priv->mru = g_list_remove_link (priv->mru, l);
+  priv->mru = g_list_concat (l, priv->mru);
+}
+
 GList *
 mnb_alttab_overlay_get_app_list (MnbAlttabOverlay *self)
 {
-  MutterPlugin *plugin;
-  MetaScreen   *screen;
-  GList        *l, *filtered = NULL;
-
-  plugin = meego_netbook_get_plugin_singleton ();
-  screen = mutter_plugin_get_screen (plugin);
+  MnbAlttabOverlayPrivate *priv = self->priv;
+  GList                   *l, *filtered = NULL;
 
-  for (l = mutter_get_windows (screen); l; l = l->next)
+  for (l = priv->mru; l; l = l->next)
     {
       MutterWindow *m = l->data;
       MetaWindow   *w = mutter_window_get_meta_window (m);
@@ -154,9 +255,7 @@ mnb_alttab_overlay_get_app_list (MnbAlttabOverlay *self)
       type = mutter_window_get_window_type (m);
 
       if (meta_window_is_on_all_workspaces (w)   ||
-          mutter_window_is_override_redirect (m) || /* Unecessary */
-          (type != META_COMP_WINDOW_NORMAL  &&
-           type != META_COMP_WINDOW_DIALOG))
+          mutter_window_is_override_redirect (m)) /* Unecessary */
         {
           continue;
         }
@@ -182,17 +281,24 @@ mnb_alttab_overlay_get_app_list (MnbAlttabOverlay *self)
       return NULL;
     }
 
-  /*
-   * Sort the windows in MRU order
-   */
-  filtered = g_list_sort (filtered, sort_windows_by_user_time);
+  return g_list_reverse (filtered);
+}
 
-  return filtered;
+static void
+mnb_alttab_overlay_app_free (gpointer data)
+{
+  ClutterActor *app = data;
+
+  clutter_actor_destroy (app);
+  g_object_unref (app);
 }
 
 /*
  * If there are less that 2 applications, no population is done, and return
  * value is FALSE.
+ *
+ * The apps are cached across invocations, and the grid is only modified from
+ * the first position where its contents no longer match the MRU list.
  */
 static gboolean
 mnb_alttab_overlay_populate (MnbAlttabOverlay *self)
@@ -200,7 +306,8 @@ mnb_alttab_overlay_populate (MnbAlttabOverlay *self)
   MutterPlugin               *plugin = meego_netbook_get_plugin_singleton ();
   MeegoNetbookPluginPrivate *ppriv  = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
   MnbAlttabOverlayPrivate    *priv = self->priv;
-  GList                      *l, *filtered = NULL, *active = NULL;
+  ClutterContainer           *grid = CLUTTER_CONTAINER (priv->grid);
+  GList                      *l, *c, *filtered = NULL, *children;
 
   filtered = mnb_alttab_overlay_get_app_list (self);
 
@@ -210,42 +317,61 @@ mnb_alttab_overlay_populate (MnbAlttabOverlay *self)
       return FALSE;
     }
 
-  for (l = filtered; l; l = l->next)
+  /*
+   * The apps are constructed with the desktop background, so if that changed,
+   * we need new ones.
+   */
+  if (priv->apps_background != ppriv->desktop_tex)
     {
-      MutterWindow          *m = l->data;
-      MnbAlttabOverlayApp *app;
+      g_hash_table_remove_all (priv->apps);
+      priv->apps_background = ppriv->desktop_tex;
+    }
 
-      app = mnb_alttab_overlay_app_new (m, ppriv->desktop_tex);
+  children = clutter_container_get_children (grid);
 
-      if (!active)
-        active = l->next;
+  for (l = filtered, c = children; l && c; l = l->next, c = c->next)
+    if (c->data != g_hash_table_lookup (priv->apps, l->data))
+      break;
 
-      /*
-       * Mark second application active.
-       */
-      if (l == active)
+  /*
+   * Detach the rest of the grid (the apps stay in the cache), and append the
+   * remaining apps in the MRU order.
+   */
+  for (; c; c = c->next)
+    clutter_container_remove_actor (grid, c->data);
+
+  for (; l; l = l->next)
+    {
+      MutterWindow        *m = l->data;
+      MnbAlttabOverlayApp *app;
+
+      if (!(app = g_hash_table_lookup (priv->apps, m)))
         {
-          mnb_alttab_overlay_app_set_active (app, TRUE);
-          priv->active = app;
+          app = mnb_alttab_overlay_app_new (m, ppriv->desktop_tex);
+          g_hash_table_insert (priv->apps, m, g_object_ref_sink (app));
         }
 
-      clutter_container_add_actor (CLUTTER_CONTAINER (priv->grid),
-                                   (ClutterActor*) app);
+      clutter_container_add_actor (grid, (ClutterActor*) app);
     }
 
-  g_list_free (filtered);
+  g_list_free (children);
 
-  return TRUE;
-}
+  /*
+   * Mark second application active.
+   */
+  for (l = filtered; l; l = l->next)
+    {
+      MnbAlttabOverlayApp *app = g_hash_table_lookup (priv->apps, l->data);
 
-static void
-mnb_alttab_overlay_depopulate (MnbAlttabOverlay *self)
-{
-  MnbAlttabOverlayPrivate *priv = self->priv;
+      mnb_alttab_overlay_app_set_active (app, l == filtered->next);
 
-  clutter_container_foreach (CLUTTER_CONTAINER (priv->grid),
-                             (ClutterCallback)clutter_actor_destroy,
-                             NULL);
+      if (l == filtered->next)
+        priv->active = app;
+    }
+
+  g_list_free (filtered);
+
+  return TRUE;
 }
 
 static void
@@ -278,9 +404,12 @@ mnb_alttab_overlay_kbd_grab_notify_cb (MetaScreen       *screen,
 static void
 mnb_alttab_overlay_constructed (GObject *self)
 {
-  MnbAlttabOverlayPrivate *priv   = MNB_ALTTAB_OVERLAY (self)->priv;
-  MxGrid                  *grid   = MX_GRID (mx_grid_new ());
-  MutterPlugin            *plugin = meego_netbook_get_plugin_singleton ();
+  MnbAlttabOverlayPrivate *priv    = MNB_ALTTAB_OVERLAY (self)->priv;
+  MxGrid                  *grid    = MX_GRID (mx_grid_new ());
+  MutterPlugin            *plugin  = meego_netbook_get_plugin_singleton ();
+  MetaScreen              *screen  = mutter_plugin_get_screen (plugin);
+  MetaDisplay             *display = meta_screen_get_display (screen);
+  GList                   *l;
 
   if (G_OBJECT_CLASS (mnb_alttab_overlay_parent_class)->constructed)
     G_OBJECT_CLASS (mnb_alttab_overlay_parent_class)->constructed (self);
@@ -298,10 +427,25 @@ mnb_alttab_overlay_constructed (GObject *self)
 
   mx_stylable_set_style_class (MX_STYLABLE (self),"alttab-overlay");
 
-  g_signal_connect (mutter_plugin_get_screen (plugin),
+  g_signal_connect (screen,
                     "notify::keyboard-grabbed",
                     G_CALLBACK (mnb_alttab_overlay_kbd_grab_notify_cb),
                     self);
+
+  priv->apps = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                      NULL, mnb_alttab_overlay_app_free);
+
+  g_signal_connect (display,
+                    "notify::focus-window",
+                    G_CALLBACK (mnb_alttab_overlay_focus_window_notify_cb),
+                    self);
+
+  /*
+   * Pick up any windows that are already present; new ones are added from
+   * the map effect.
+   */
+  for (l = mutter_get_windows (screen); l; l = l->next)
+    mnb_alttab_overlay_track_window (MNB_ALTTAB_OVERLAY (self), l->data);
 }
 
 static void
@@ -393,6 +537,7 @@ static void
 mnb_alttab_overlay_paint (ClutterActor *self)
 {
   MnbAlttabOverlayPrivate *priv = MNB_ALTTAB_OVERLAY (self)->priv;
+  gint64                   start = mnb_paint_profiler_begin ();
 
   CLUTTER_ACTOR_CLASS (mnb_alttab_overlay_parent_class)->paint (self);
 
@@ -418,6 +563,8 @@ mnb_alttab_overlay_paint (ClutterActor *self)
       cogl_pop_matrix ();
       cogl_clip_pop ();
     }
+
+  mnb_paint_profiler_end (MNB_PAINT_STAGE_ALTTAB, start);
 }
 
 static void
@@ -844,7 +991,6 @@ mnb_alttab_overlay_hide (MnbAlttabOverlay *overlay)
 
   /* FIXME -- do an animation */
   clutter_actor_hide ((ClutterActor*)overlay);
-  mnb_alttab_overlay_depopulate (overlay);
 }
 
 /*
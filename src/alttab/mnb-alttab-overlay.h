@@ -87,6 +87,8 @@ void     mnb_alttab_overlay_activate_window (MnbAlttabOverlay *overlay,
                                              guint               timestamp);
 void     mnb_alttab_reset_autoscroll (MnbAlttabOverlay *overlay,
                                       gboolean          backward);
+void     mnb_alttab_overlay_track_window (MnbAlttabOverlay *overlay,
+                                          MutterWindow     *mcw);
 
 G_END_DECLS
 
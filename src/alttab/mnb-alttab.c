@@ -59,6 +59,11 @@ mnb_alttab_overlay_establish_keyboard_grab (MnbAlttabOverlay  *overlay,
 {
   MnbAlttabOverlayPrivate *priv = overlay->priv;
 
+  /*
+   * The grab needs the stage input shape to be current.
+   */
+  mnb_input_manager_flush ();
+
   if (meta_display_begin_grab_op (display,
                                   screen,
                                   NULL,
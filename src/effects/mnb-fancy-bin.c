@@ -21,6 +21,8 @@
 
 #include "mnb-fancy-bin.h"
 
+#include <math.h>
+
 static void mx_stylable_iface_init (MxStylableIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (MnbFancyBin, mnb_fancy_bin, MX_TYPE_WIDGET,
@@ -46,6 +48,9 @@ struct _MnbFancyBinPrivate
   ClutterActor *child;
   ClutterActor *clone;
   guint         curve_radius;
+
+  MnbFancyBinClip clip;
+  ClutterActorBox clip_box; /* the child box, updated on allocation */
 };
 
 
@@ -133,6 +138,46 @@ mnb_fancy_bin_finalize (GObject *object)
   G_OBJECT_CLASS (mnb_fancy_bin_parent_class)->finalize (object);
 }
 
+/*
+ * Pushes a window clip for the child box, if the bin is not rotated (which is
+ * always the case in the zones preview); returns FALSE if no clip was pushed.
+ */
+static gboolean
+mnb_fancy_bin_push_scissor_clip (MnbFancyBin *self)
+{
+  MnbFancyBinPrivate *priv = self->priv;
+  ClutterActor       *actor = CLUTTER_ACTOR (self);
+  ClutterVertex       corners[3];
+  ClutterVertex       v[3];
+  gint                i;
+  gint                x1, y1, x2, y2;
+
+  corners[0].x = priv->clip_box.x1;
+  corners[0].y = priv->clip_box.y1;
+  corners[1].x = priv->clip_box.x2;
+  corners[1].y = priv->clip_box.y2;
+  corners[2].x = priv->clip_box.x2;
+  corners[2].y = priv->clip_box.y1;
+
+  for (i = 0; i < 3; i++)
+    {
+      corners[i].z = 0.0;
+      clutter_actor_apply_transform_to_point (actor, &corners[i], &v[i]);
+    }
+
+  if (fabsf (v[2].y - v[0].y) > 0.5 || fabsf (v[2].x - v[1].x) > 0.5)
+    return FALSE;
+
+  x1 = floorf (MIN (v[0].x, v[1].x) + 0.5);
+  y1 = floorf (MIN (v[0].y, v[1].y) + 0.5);
+  x2 = floorf (MAX (v[0].x, v[1].x) + 0.5);
+  y2 = floorf (MAX (v[0].y, v[1].y) + 0.5);
+
+  cogl_clip_push_window_rectangle (x1, y1, x2 - x1, y2 - y1);
+
+  return TRUE;
+}
+
 static void
 mnb_fancy_bin_paint (ClutterActor *actor)
 {
@@ -140,7 +185,20 @@ mnb_fancy_bin_paint (ClutterActor *actor)
   MnbFancyBinPrivate *priv = self->priv;
 
   /* Draw the clipped child if necessary */
-  if (priv->fanciness > 0.0)
+  if ((priv->fanciness > 0.0) &&
+      (priv->clip == MNB_FANCY_BIN_CLIP_SCISSOR) &&
+      mnb_fancy_bin_push_scissor_clip (self))
+    {
+      /* Paint child */
+      if (priv->child)
+        clutter_actor_paint (priv->child);
+
+      cogl_clip_pop ();
+
+      /* Chain up for background; this also covers the corners of the child */
+      CLUTTER_ACTOR_CLASS (mnb_fancy_bin_parent_class)->paint (actor);
+    }
+  else if (priv->fanciness > 0.0)
     {
       MxPadding padding;
       gfloat width, height;
@@ -305,6 +363,8 @@ mnb_fancy_bin_allocate (ClutterActor          *actor,
   if (priv->child)
     clutter_actor_allocate (priv->child, &child_box, flags);
 
+  priv->clip_box = child_box;
+
   if (priv->clone)
     clutter_actor_allocate (priv->clone, &child_box, flags);
 
@@ -464,3 +524,17 @@ mnb_fancy_bin_get_fancy (MnbFancyBin *bin)
 {
   return bin->priv->fancy;
 }
+
+void
+mnb_fancy_bin_set_clip (MnbFancyBin *bin, MnbFancyBinClip clip)
+{
+  MnbFancyBinPrivate *priv = bin->priv;
+
+  if (priv->clip != clip)
+    {
+      priv->clip = clip;
+
+      if (priv->fanciness > 0.0)
+        clutter_actor_queue_redraw (CLUTTER_ACTOR (bin));
+    }
+}
@@ -49,6 +49,20 @@ G_BEGIN_DECLS
   (G_TYPE_INSTANCE_GET_CLASS ((obj), \
   MNB_TYPE_FANCY_BIN, MnbFancyBinClass))
 
+/*
+ * How the child is clipped while the fancy frame is shown.
+ *
+ * MNB_FANCY_BIN_CLIP_PATH clips to a rounded rectangle path, which is built
+ * and pushed to the stencil buffer on every frame; MNB_FANCY_BIN_CLIP_SCISSOR
+ * scissors the child to its (cached) box, and leaves the rounding of the
+ * corners to the frame, which is painted on top of the child.
+ */
+typedef enum
+{
+  MNB_FANCY_BIN_CLIP_SCISSOR = 0,
+  MNB_FANCY_BIN_CLIP_PATH
+} MnbFancyBinClip;
+
 typedef struct _MnbFancyBin MnbFancyBin;
 typedef struct _MnbFancyBinClass MnbFancyBinClass;
 typedef struct _MnbFancyBinPrivate MnbFancyBinPrivate;
@@ -73,6 +87,7 @@ void          mnb_fancy_bin_set_child (MnbFancyBin *bin, ClutterActor *child);
 ClutterActor *mnb_fancy_bin_get_child (MnbFancyBin *bin);
 void          mnb_fancy_bin_set_fancy (MnbFancyBin *bin, gboolean ooh_get_you);
 gboolean      mnb_fancy_bin_get_fancy (MnbFancyBin *bin);
+void          mnb_fancy_bin_set_clip  (MnbFancyBin *bin, MnbFancyBinClip clip);
 
 G_END_DECLS
 
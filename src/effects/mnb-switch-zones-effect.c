@@ -26,14 +26,23 @@
 #include "mnb-fancy-bin.h"
 #include "mnb-zones-preview.h"
 
+/*
+ * The preview is created on the first switch, and then kept (hidden) between
+ * the switches, so that its workspaces and windows need only be updated.
+ */
 static ClutterActor *zones_preview = NULL;
 static gint          running = 0;
 
+static gboolean
+mnb_switch_zones_preview_showing (void)
+{
+  return zones_preview && CLUTTER_ACTOR_IS_VISIBLE (zones_preview);
+}
+
 static void
 mnb_switch_zones_completed_cb (MnbZonesPreview *preview, MutterPlugin *plugin)
 {
-  clutter_actor_destroy (zones_preview);
-  zones_preview = NULL;
+  clutter_actor_hide (zones_preview);
 
   if (--running < 0)
     {
@@ -75,7 +84,7 @@ mnb_switch_zones_effect (MutterPlugin         *plugin,
       mutter_plugin_switch_workspace_completed (plugin);
     }
 
-  if ((from == to) && !zones_preview)
+  if ((from == to) && !mnb_switch_zones_preview_showing ())
     {
       if (--running < 0)
         {
@@ -96,9 +105,7 @@ mnb_switch_zones_effect (MutterPlugin         *plugin,
 
       /* Construct the zones preview actor */
       zones_preview = mnb_zones_preview_new ();
-      g_object_set (G_OBJECT (zones_preview),
-                    "workspace", (gdouble)from,
-                    NULL);
+      clutter_actor_hide (zones_preview);
 
       /* Add it to the stage */
       stage = mutter_get_stage_for_screen (screen);
@@ -109,6 +116,14 @@ mnb_switch_zones_effect (MutterPlugin         *plugin,
                         G_CALLBACK (mnb_switch_zones_completed_cb), plugin);
     }
 
+  if (!CLUTTER_ACTOR_IS_VISIBLE (zones_preview))
+    {
+      g_object_set (G_OBJECT (zones_preview),
+                    "workspace", (gdouble)from,
+                    NULL);
+      clutter_actor_show (zones_preview);
+    }
+
   mutter_plugin_query_screen_size (plugin, &width, &height);
   g_object_set (G_OBJECT (zones_preview),
                 "workspace-width", (guint)width,
@@ -116,7 +131,7 @@ mnb_switch_zones_effect (MutterPlugin         *plugin,
                 "workspace-bg", priv->desktop_tex,
                 NULL);
 
-  mnb_zones_preview_clear (MNB_ZONES_PREVIEW (zones_preview));
+  mnb_zones_preview_begin_update (MNB_ZONES_PREVIEW (zones_preview));
   mnb_zones_preview_set_n_workspaces (MNB_ZONES_PREVIEW (zones_preview),
                                       meta_screen_get_n_workspaces (screen));
 
@@ -141,6 +156,8 @@ mnb_switch_zones_effect (MutterPlugin         *plugin,
       mnb_zones_preview_add_window (MNB_ZONES_PREVIEW (zones_preview), window);
     }
 
+  mnb_zones_preview_end_update (MNB_ZONES_PREVIEW (zones_preview));
+
   /* Make sure it's on top */
   window_group = mutter_plugin_get_window_group (plugin);
   clutter_actor_raise (zones_preview, window_group);
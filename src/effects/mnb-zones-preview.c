@@ -21,6 +21,9 @@
 
 #include "mnb-zones-preview.h"
 #include "mnb-fancy-bin.h"
+#include "../mnb-paint-profiler.h"
+#include "../mnb-thumbnail.h"
+#include "../meego-netbook.h"
 
 #include <stdlib.h>
 
@@ -30,6 +33,12 @@ G_DEFINE_TYPE_WITH_CODE (MnbZonesPreview, mnb_zones_preview, MX_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (MX_TYPE_STYLABLE,
                                                 mx_stylable_iface_init))
 
+/*
+ * Size of the window thumbnails, relative to the preview; when zoomed in
+ * further than this, the thumbnails paint the windows at full size.
+ */
+#define MNB_ZONES_PREVIEW_THUMBNAIL_SCALE 0.5
+
 #define ZONES_PREVIEW_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), MNB_TYPE_ZONES_PREVIEW, MnbZonesPreviewPrivate))
 
@@ -71,8 +80,23 @@ struct _MnbZonesPreviewPrivate
   guint                 width;
   guint                 height;
   MnbZonesPreviewPhase  anim_phase;
+
+  GHashTable           *windows;    /* MutterWindow -> MnbZonesPreviewWindow */
+  guint                 generation; /* of the current update */
 };
 
+/*
+ * A window shown in the preview; the preview is kept between workspace
+ * switches, and the windows are only updated for each switch.
+ */
+typedef struct
+{
+  MnbZonesPreview *preview;
+  MutterWindow    *mcw;
+  ClutterActor    *thumbnail;
+  guint            generation;
+} MnbZonesPreviewWindow;
+
 static void
 mnb_zones_preview_get_property (GObject    *object,
                                 guint       property_id,
@@ -126,18 +150,35 @@ mnb_zones_preview_set_property (GObject      *object,
       priv->workspace = g_value_get_double (value);
       break;
 
+    /*
+     * The workspace size and background are baked into the workspace bins;
+     * if they change, the bins have to be rebuilt.
+     */
     case PROP_WORKSPACE_WIDTH:
-      priv->width = g_value_get_uint (value);
+      if (priv->width != g_value_get_uint (value))
+        {
+          mnb_zones_preview_clear (MNB_ZONES_PREVIEW (object));
+          priv->width = g_value_get_uint (value);
+        }
       break;
 
     case PROP_WORKSPACE_HEIGHT:
-      priv->height = g_value_get_uint (value);
+      if (priv->height != g_value_get_uint (value))
+        {
+          mnb_zones_preview_clear (MNB_ZONES_PREVIEW (object));
+          priv->height = g_value_get_uint (value);
+        }
       break;
 
     case PROP_WORKSPACE_BG:
-      if (priv->workspace_bg)
-        g_object_unref (priv->workspace_bg);
-      priv->workspace_bg = g_value_dup_object (value);
+      if (priv->workspace_bg != g_value_get_object (value))
+        {
+          mnb_zones_preview_clear (MNB_ZONES_PREVIEW (object));
+
+          if (priv->workspace_bg)
+            g_object_unref (priv->workspace_bg);
+          priv->workspace_bg = g_value_dup_object (value);
+        }
       break;
 
     default:
@@ -156,6 +197,12 @@ mnb_zones_preview_dispose (GObject *object)
 
   mnb_zones_preview_clear (self);
 
+  if (priv->windows)
+    {
+      g_hash_table_destroy (priv->windows);
+      priv->windows = NULL;
+    }
+
   if (priv->workspace_bg)
     {
       g_object_unref (priv->workspace_bg);
@@ -176,6 +223,7 @@ mnb_zones_preview_paint (ClutterActor *actor)
 {
   GList *w;
   MnbZonesPreviewPrivate *priv = MNB_ZONES_PREVIEW (actor)->priv;
+  gint64 start = mnb_paint_profiler_begin ();
 
   /* Chain up for background */
   CLUTTER_ACTOR_CLASS (mnb_zones_preview_parent_class)->paint (actor);
@@ -183,6 +231,8 @@ mnb_zones_preview_paint (ClutterActor *actor)
   /* Paint bins */
   for (w = priv->workspace_bins; w; w = w->next)
     clutter_actor_paint (CLUTTER_ACTOR (w->data));
+
+  mnb_paint_profiler_end (MNB_PAINT_STAGE_ZONES, start);
 }
 
 static void
@@ -405,6 +455,12 @@ mnb_zones_preview_style_changed_cb (MxStylable          *stylable,
                      NULL);
 }
 
+static void
+mnb_zones_preview_window_free (gpointer data)
+{
+  g_slice_free (MnbZonesPreviewWindow, data);
+}
+
 static void
 mnb_zones_preview_init (MnbZonesPreview *self)
 {
@@ -413,6 +469,8 @@ mnb_zones_preview_init (MnbZonesPreview *self)
   priv->zoom = 1.0;
   priv->spacing = 24;
   priv->dest_workspace = -1;
+  priv->windows = g_hash_table_new_full (NULL, NULL, NULL,
+                                         mnb_zones_preview_window_free);
 
   g_signal_connect (self, "style-changed",
                     G_CALLBACK (mnb_zones_preview_style_changed_cb), self);
@@ -600,6 +658,15 @@ mnb_zones_preview_get_workspace_group (MnbZonesPreview *preview,
       bin = mnb_fancy_bin_new ();
       group = clutter_group_new ();
 
+      /*
+       * The path clip is expensive, but can be requested for comparison
+       * (see mnb-fancy-bin.h).
+       */
+      if (meego_netbook_get_compositor_option_flags () &
+          MNB_OPTION_FANCY_BIN_PATH_CLIP)
+        mnb_fancy_bin_set_clip (MNB_FANCY_BIN (bin),
+                                MNB_FANCY_BIN_CLIP_PATH);
+
       /* Add background if it's set */
       if (priv->workspace_bg)
         {
@@ -647,69 +714,136 @@ mnb_zones_preview_set_n_workspaces (MnbZonesPreview *preview,
     }
 }
 
-static void mnb_zones_preview_clone_destroy_cb (ClutterActor *, ClutterActor *);
+static void mnb_zones_preview_thumbnail_destroy_cb (ClutterActor          *,
+                                                    MnbZonesPreviewWindow *);
 
 /*
- * If the window is destroyed, we have to destroy the clone.
+ * If the window is destroyed, we have to destroy the thumbnail.
  */
 static void
-mnb_zones_preview_mcw_destroy_cb (ClutterActor *mcw, ClutterActor *clone)
+mnb_zones_preview_mcw_destroy_cb (ClutterActor          *mcw,
+                                  MnbZonesPreviewWindow *pw)
 {
-  /*
-   * First disconnect the clone_destroy handler to avoid circularity.
-   */
-  g_signal_handlers_disconnect_by_func (clone,
-                                        mnb_zones_preview_clone_destroy_cb,
-                                        mcw);
-
-  clutter_actor_destroy (clone);
+  clutter_actor_destroy (pw->thumbnail);
 }
 
 /*
- * When the clone goes away, disconnect the mcw destroy handler.
+ * When the thumbnail goes away (either because the window was destroyed, or
+ * because its workspace bin was), stop tracking the window.
  */
 static void
-mnb_zones_preview_clone_destroy_cb (ClutterActor *clone, ClutterActor *mcw)
+mnb_zones_preview_thumbnail_destroy_cb (ClutterActor          *thumbnail,
+                                        MnbZonesPreviewWindow *pw)
 {
-  g_signal_handlers_disconnect_by_func (mcw,
+  MnbZonesPreviewPrivate *priv = pw->preview->priv;
+
+  g_signal_handlers_disconnect_by_func (pw->mcw,
                                         mnb_zones_preview_mcw_destroy_cb,
-                                        clone);
+                                        pw);
+
+  if (priv->windows)
+    g_hash_table_remove (priv->windows, pw->mcw);
+}
+
+/*
+ * Starts an update of the windows in the preview; windows that are not
+ * added again by mnb_zones_preview_add_window() before the matching
+ * mnb_zones_preview_end_update() are removed from the preview.
+ */
+void
+mnb_zones_preview_begin_update (MnbZonesPreview *preview)
+{
+  MnbZonesPreviewPrivate *priv = preview->priv;
+
+  priv->generation++;
+}
+
+void
+mnb_zones_preview_end_update (MnbZonesPreview *preview)
+{
+  MnbZonesPreviewPrivate *priv = preview->priv;
+  GHashTableIter          iter;
+  gpointer                value;
+  GList                  *stale = NULL, *l;
+
+  g_hash_table_iter_init (&iter, priv->windows);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      MnbZonesPreviewWindow *pw = value;
+
+      if (pw->generation != priv->generation)
+        stale = g_list_prepend (stale, pw->thumbnail);
+    }
+
+  /* The destroy handler removes the windows from the hash table */
+  for (l = stale; l; l = l->next)
+    clutter_actor_destroy (CLUTTER_ACTOR (l->data));
+
+  g_list_free (stale);
 }
 
+/*
+ * Adds the window to the preview, or, if it is already there, moves it to
+ * its current workspace and position, and to the top of the stack.
+ */
 void
 mnb_zones_preview_add_window (MnbZonesPreview *preview,
                               MutterWindow    *window)
 {
-  ClutterActor *clone;
+  MnbZonesPreviewPrivate *priv = preview->priv;
+  MnbZonesPreviewWindow *pw;
   ClutterActor *group;
+  ClutterActor *parent;
   MetaRectangle rect;
   gint workspace;
 
-  /* TODO: Determine if we need to add a weak reference on the window
-   *       in case it gets destroyed during the animation.
-   *       I'd have thought that the clone's reference on the texture
-   *       would be enough that this wouldn't be necessary.
-   *
-   * We do; while the clone's reference is enough to keep the texture about,
-   * it is not enough to make it possible to map the clone once the texture
-   * has been unparented.
-   */
   workspace = mutter_window_get_workspace (window);
   group = mnb_zones_preview_get_workspace_group (preview, workspace);
 
-  clone = clutter_clone_new (mutter_window_get_texture (window));
+  if (!(pw = g_hash_table_lookup (priv->windows, window)))
+    {
+      pw = g_slice_new0 (MnbZonesPreviewWindow);
+      pw->preview = preview;
+      pw->mcw = window;
+      pw->thumbnail =
+        mnb_thumbnail_new (window,
+                           priv->width * MNB_ZONES_PREVIEW_THUMBNAIL_SCALE,
+                           priv->height * MNB_ZONES_PREVIEW_THUMBNAIL_SCALE);
+
+      g_hash_table_insert (priv->windows, window, pw);
+
+      /*
+       * While the thumbnail's reference on the texture is enough to keep the
+       * texture about, it is not enough to make it possible to map the
+       * thumbnail once the texture has been unparented, so we have to track
+       * the window.
+       */
+      g_signal_connect (window, "destroy",
+                        G_CALLBACK (mnb_zones_preview_mcw_destroy_cb),
+                        pw);
+      g_signal_connect (pw->thumbnail, "destroy",
+                        G_CALLBACK (mnb_zones_preview_thumbnail_destroy_cb),
+                        pw);
+
+      clutter_container_add_actor (CLUTTER_CONTAINER (group), pw->thumbnail);
+    }
+  else if ((parent = clutter_actor_get_parent (pw->thumbnail)) != group)
+    {
+      /* The window moved to a different workspace */
+      g_object_ref (pw->thumbnail);
+      clutter_container_remove_actor (CLUTTER_CONTAINER (parent),
+                                      pw->thumbnail);
+      clutter_container_add_actor (CLUTTER_CONTAINER (group), pw->thumbnail);
+      g_object_unref (pw->thumbnail);
+    }
 
-  g_signal_connect (window, "destroy",
-                    G_CALLBACK (mnb_zones_preview_mcw_destroy_cb),
-                    clone);
-  g_signal_connect (clone, "destroy",
-                    G_CALLBACK (mnb_zones_preview_clone_destroy_cb),
-                    window);
+  pw->generation = priv->generation;
 
   meta_window_get_outer_rect (mutter_window_get_meta_window (window), &rect);
-  clutter_actor_set_position (clone, rect.x, rect.y);
+  clutter_actor_set_position (pw->thumbnail, rect.x, rect.y);
 
-  clutter_container_add_actor (CLUTTER_CONTAINER (group), clone);
+  /* Windows are added bottom to top */
+  clutter_actor_raise_top (pw->thumbnail);
 }
 
 void
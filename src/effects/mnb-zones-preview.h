@@ -72,9 +72,13 @@ GType mnb_zones_preview_get_type (void) G_GNUC_CONST;
 
 ClutterActor *mnb_zones_preview_new (void);
 
+void mnb_zones_preview_begin_update (MnbZonesPreview *preview);
+
 void mnb_zones_preview_add_window (MnbZonesPreview *preview,
                                    MutterWindow    *window);
 
+void mnb_zones_preview_end_update (MnbZonesPreview *preview);
+
 void mnb_zones_preview_change_workspace (MnbZonesPreview *preview,
                                          gint             workspace);
 
@@ -36,6 +36,7 @@
 #include "mnb-panel-frame.h"
 #include "meego-netbook-constraints.h"
 #include "meego-netbook-mutter-hints.h"
+#include "mnb-paint-profiler.h"
 #include "notifications/ntf-overlay.h"
 
 #include <compositor-mutter.h>
@@ -44,6 +45,7 @@
 #include <keybindings.h>
 #include <errors.h>
 #include <X11/extensions/scrnsaver.h>
+#include <X11/extensions/shape.h>
 
 /*
  * Including mutter's errors.h defines the i18n macros, so undefine them before
@@ -81,6 +83,7 @@
 #define KEY_THEME THEME_KEY_DIR "/theme"
 #define KEY_BUTTONS THEME_KEY_DIR "/button_layout"
 #define KEY_ALLWAYS_SMALL_SCREEN "/desktop/meego/always_small_screen_mode"
+#define KEY_INSTANT_MODE "/desktop/meego/instant_mode"
 
 static guint32 compositor_options = 0;
 
@@ -90,6 +93,9 @@ static const GDebugKey options_keys[] =
   { "disable-ws-clamp",           MNB_OPTION_DISABLE_WS_CLAMP },
   { "disable-panel-restart",      MNB_OPTION_DISABLE_PANEL_RESTART },
   { "composite-fullscreen-apps",  MNB_OPTION_COMPOSITE_FULLSCREEN_APPS },
+  { "prewarm-panels",             MNB_OPTION_PREWARM_PANELS },
+  { "lazy-panels",                MNB_OPTION_LAZY_PANELS },
+  { "fancy-bin-path-clip",        MNB_OPTION_FANCY_BIN_PATH_CLIP },
 };
 
 static MutterPlugin *plugin_singleton = NULL;
@@ -102,6 +108,7 @@ typedef struct
 } EffectCompleteData;
 
 static void desktop_background_init (MutterPlugin *plugin);
+static void instant_mode_init (MutterPlugin *plugin);
 static void setup_focus_window (MutterPlugin *plugin);
 static void setup_screen_saver (MutterPlugin *plugin);
 
@@ -197,6 +204,14 @@ meego_netbook_plugin_dispose (GObject *object)
 static void
 meego_netbook_plugin_finalize (GObject *object)
 {
+  MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (object)->priv;
+
+  if (priv->bg_occlusion)
+    {
+      mnb_background_occlusion_free (priv->bg_occlusion);
+      priv->bg_occlusion = NULL;
+    }
+
   mnb_input_manager_destroy ();
 
   G_OBJECT_CLASS (meego_netbook_plugin_parent_class)->finalize (object);
@@ -316,6 +331,12 @@ meego_netbook_workspace_switched_cb (MetaScreen          *screen,
   MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
   gboolean on;
 
+  /*
+   * The set of visible windows has changed wholesale.
+   */
+  if (priv->bg_occlusion)
+    mnb_background_occlusion_invalidate (priv->bg_occlusion);
+
   if (compositor_options & MNB_OPTION_COMPOSITE_FULLSCREEN_APPS)
     return;
 
@@ -562,6 +583,9 @@ meego_netbook_handle_screen_size (MutterPlugin *plugin,
   old_screen_width  = *screen_width;
   old_screen_height = *screen_height;
 
+  if (priv->bg_occlusion)
+    mnb_background_occlusion_invalidate (priv->bg_occlusion);
+
   force_small_screen = gconf_client_get_bool (priv->gconf_client,
                                               KEY_ALLWAYS_SMALL_SCREEN,
                                               NULL);
@@ -670,6 +694,8 @@ meego_netbook_plugin_start (MutterPlugin *plugin)
 
   gconf_client = priv->gconf_client = gconf_client_get_default ();
 
+  instant_mode_init (plugin);
+
   /*
    * Disable the cycle_group bindings; the default for this is Alt+` which
    * breaks non-English platforms, BMC#11875
@@ -728,6 +754,18 @@ meego_netbook_plugin_start (MutterPlugin *plugin)
   overlay = mutter_plugin_get_overlay_group (plugin);
 
   mnb_input_manager_create (plugin);
+  mnb_paint_profiler_init (stage);
+
+  priv->bg_occlusion = mnb_background_occlusion_new (screen);
+
+  /*
+   * Mutter selects ShapeNotify on the client windows itself; we only need to
+   * know the event base to spot changes of window shape for the background
+   * occlusion.
+   */
+  if (!XShapeQueryExtension (mutter_plugin_get_xdisplay (plugin),
+                             &priv->shape_base, &priv->shape_error))
+    priv->shape_base = 0;
 
   setup_focus_window (plugin);
   setup_screen_saver (plugin);
@@ -1805,6 +1843,13 @@ map (MutterPlugin *plugin, MutterWindow *mcw)
   xwin         = mutter_window_get_x_window (mcw);
   mw           = mutter_window_get_meta_window (mcw);
 
+  if (priv->bg_occlusion)
+    mnb_background_occlusion_track_window (priv->bg_occlusion, mcw);
+
+  if (priv->switcher_overlay)
+    mnb_alttab_overlay_track_window (MNB_ALTTAB_OVERLAY (priv->switcher_overlay),
+                                     mcw);
+
   if (active_panel &&
       meego_netbook_window_is_modal_for_panel (active_panel, mw))
     {
@@ -2132,6 +2177,17 @@ xevent_filter (MutterPlugin *plugin, XEvent *xev)
         }
     }
 
+  /*
+   * A window changing its shape changes what it occludes; mutter only picks
+   * the new shape up when painting next, which is also when the occlusion
+   * gets rebuilt.
+   */
+  if (priv->shape_base && xev->type == priv->shape_base + ShapeNotify &&
+      priv->bg_occlusion)
+    {
+      mnb_background_occlusion_invalidate (priv->bg_occlusion);
+    }
+
   /*
    * Avoid any unnecessary procesing here, as this function is called all the
    * time.
@@ -2268,83 +2324,106 @@ setup_screen_saver (MutterPlugin *plugin)
   meta_error_trap_pop (display, FALSE);
 }
 
-GdkRegion *mutter_window_get_obscured_region (MutterWindow *cw);
-gboolean   mutter_window_effect_in_progress (MutterWindow *self);
-
 /*
- * Based on the occlusion code in MutterWindowGroup
- *
  * Returns the visible region that needs to be painted, or NULL, if the
- * entire area needs to be painted.
+ * entire area needs to be painted. The returned region is owned by the
+ * occlusion tracker (see mnb-background-occlusion.c), and is only recalculated
+ * when windows change.
  */
-GdkRegion *
-mnb_get_background_visible_region (MetaScreen *screen)
+static const GdkRegion *
+mnb_get_background_visible_region (MutterPlugin *plugin)
 {
-  GList       *l;
-  GdkRegion   *visible_region;
-  GdkRectangle screen_rect = { 0 };
+  MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
 
-  l = mutter_get_windows (screen);
+  if (!priv->bg_occlusion)
+    return NULL;
 
-  /* Start off with the full screen area (for a multihead setup, we
-   * might want to use a more accurate union of the monitors to avoid
-   * painting in holes from mismatched monitor sizes. That's just an
-   * optimization, however.)
-   */
-  meta_screen_get_size (screen, &screen_rect.width, &screen_rect.height);
-  visible_region = gdk_region_rectangle (&screen_rect);
+  return mnb_background_occlusion_get_visible_region (priv->bg_occlusion);
+}
 
-  for (; l; l = l->next)
-    {
-      MutterWindow *cw;
-      ClutterActor *actor;
+/*
+ * If the visible part of the background covers more than this share of the
+ * screen, a single full-screen quad is cheaper than the partial paint.
+ */
+#define MNB_BG_FULL_PAINT_THRESHOLD 0.75
+
+static guint bg_paint_counts[MNB_BG_PAINT_LAST];
+
+/*
+ * Merges rectangles that share their horizontal extent and are vertically
+ * adjacent; GdkRegion stores its rectangles in y-x banded order, and only
+ * merges them horizontally, so a window hole produces a column of rectangles
+ * that can be drawn as one.
+ *
+ * As the rectangles are banded, a rectangle can only extend one of the
+ * outputs that the previous band went into, and as both are sorted by x, the
+ * two can be walked in step, so this is linear in the number of rectangles.
+ *
+ * Returns the new number of rectangles.
+ */
+static gint
+mnb_desktop_merge_rectangles (GdkRectangle *rects, gint n_rects)
+{
+  static GArray *bands = NULL; /* output index of each input rectangle */
 
-      if (!MUTTER_IS_WINDOW (l->data) || !CLUTTER_ACTOR_IS_VISIBLE (l->data))
-        continue;
+  gint i, n_out = 0;
+  gint prev_start = 0, prev_end = 0, cur_start = 0, p = 0;
+  gint band_y = 0;
 
-      cw = l->data;
-      actor = l->data;
+  if (!bands)
+    bands = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  g_array_set_size (bands, 0);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GdkRectangle rect = rects[i];
+      gint         out_index = -1;
 
-      if (mutter_window_effect_in_progress (cw))
+      if (!i || rect.y != band_y)
         {
-          gdk_region_destroy (visible_region);
-          return NULL;
+          prev_start = cur_start;
+          prev_end   = bands->len;
+          cur_start  = bands->len;
+          p          = prev_start;
+          band_y     = rect.y;
         }
 
-      /*
-       * MutterWindowGroup adds a test whether the actor is transformed or not;
-       * since we do not transform windows in any way, this was omitted.
-       */
-      if (clutter_actor_get_paint_opacity (actor) == 0xff)
+      while (p < prev_end &&
+             rects[g_array_index (bands, gint, p)].x < rect.x)
+        p++;
+
+      if (p < prev_end)
         {
-          GdkRegion *obscured_region;
+          GdkRectangle *out = &rects[g_array_index (bands, gint, p)];
 
-          if ((obscured_region = mutter_window_get_obscured_region (cw)))
+          if (out->x == rect.x && out->width == rect.width &&
+              out->y + out->height == rect.y)
             {
-              gfloat x, y;
-
-              /* Temporarily move to the coordinate system of the actor */
-              clutter_actor_get_position (actor, &x, &y);
-              gdk_region_offset (visible_region, - (gint)x, - (gint)y);
-
-              gdk_region_subtract (visible_region, obscured_region);
-
-              /* Move back to original coord system */
-              gdk_region_offset (visible_region, (gint)x, (gint)y);
+              out->height += rect.height;
+              out_index = g_array_index (bands, gint, p);
+              p++;
             }
         }
+
+      if (out_index < 0)
+        {
+          rects[n_out] = rect;
+          out_index = n_out++;
+        }
+
+      g_array_append_val (bands, out_index);
     }
 
-  return visible_region;
+  return n_out;
 }
 
 /*
  * Based on mutter_shaped_texture_paint()
  *
  * If complete == TRUE the texture is painted in it's entirety, otherwise only
- * parts not occluded by windows are painted (up to a point; if the partial
- * paint require more than MAX_RECTS of separate calls to cogl, the whole
- * texture is painted instead).
+ * parts not occluded by windows are painted (unless the visible part covers
+ * most of the screen, in which case the whole texture is painted instead).
  *
  * Returns TRUE if the texture was painted; if FALSE, regular path for
  * painting textures should be fallen back on.
@@ -2356,6 +2435,7 @@ mnb_desktop_texture_paint (ClutterActor *actor,
                            MetaScreen   *screen)
 {
   static CoglHandle material = COGL_INVALID_HANDLE;
+  static GArray    *coords   = NULL;
 
   MutterPlugin               *plugin = meego_netbook_get_plugin_singleton ();
   MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
@@ -2367,12 +2447,14 @@ mnb_desktop_texture_paint (ClutterActor *actor,
   gfloat vw = 0.5, vh = 0.5;    /* scaled texture half-size */
 
   ClutterActorBox alloc;
-  GdkRegion *visible_region = NULL;
+  const GdkRegion *visible_region = NULL;
+  GdkRectangle    *rects = NULL;
+  gint             n_rects = 0;
   gboolean retval = TRUE;
 
   if (!complete)
     {
-      visible_region = mnb_get_background_visible_region (screen);
+      visible_region = mnb_get_background_visible_region (plugin);
 
       /*
        * If the visible region is NULL (e.g., effect is running), force
@@ -2381,7 +2463,10 @@ mnb_desktop_texture_paint (ClutterActor *actor,
       if (!visible_region)
         complete = TRUE;
       else if (gdk_region_empty (visible_region))
-        goto finish_up;
+        {
+          bg_paint_counts[MNB_BG_PAINT_SKIPPED]++;
+          goto finish_up;
+        }
     }
 
   if (!CLUTTER_ACTOR_IS_REALIZED (actor))
@@ -2398,6 +2483,38 @@ mnb_desktop_texture_paint (ClutterActor *actor,
   if (tex_width == 0 || tex_height == 0) /* no contents yet */
     goto finish_up;
 
+  clutter_actor_get_allocation_box (actor, &alloc);
+
+  bw = tex_width;
+  bh = tex_height;
+
+  aw = alloc.x2 - alloc.x1;
+  ah = alloc.y2 - alloc.y1;
+
+  if (!complete)
+    {
+      gint  i;
+      gint  area = 0;
+
+      gdk_region_get_rectangles (visible_region, &rects, &n_rects);
+
+      for (i = 0; i < n_rects; i++)
+        area += rects[i].width * rects[i].height;
+
+      if (area > aw * ah * MNB_BG_FULL_PAINT_THRESHOLD)
+        {
+          bg_paint_counts[MNB_BG_PAINT_FALLBACK]++;
+          complete = TRUE;
+        }
+      else
+        {
+          bg_paint_counts[MNB_BG_PAINT_PARTIAL]++;
+          n_rects = mnb_desktop_merge_rectangles (rects, n_rects);
+        }
+    }
+  else
+    bg_paint_counts[MNB_BG_PAINT_COMPLETE]++;
+
   if (material == COGL_INVALID_HANDLE)
     material = cogl_material_new ();
 
@@ -2412,14 +2529,6 @@ mnb_desktop_texture_paint (ClutterActor *actor,
 
   cogl_set_source (material);
 
-  clutter_actor_get_allocation_box (actor, &alloc);
-
-  bw = tex_width;
-  bh = tex_height;
-
-  aw = alloc.x2 - alloc.x1;
-  ah = alloc.y2 - alloc.y1;
-
   if (priv->scaled_background)
     {
       /*
@@ -2454,115 +2563,103 @@ mnb_desktop_texture_paint (ClutterActor *actor,
                                               alloc.y2 - alloc.y1,
                                               tx1, ty1,
                                               tx2, ty2);
-          return TRUE;
         }
       else
-        return FALSE;
+        {
+          /*
+           * This is the simple case; we return FALSE, allowing the paint to
+           * reach the normal texture paint method.
+           */
+          retval = FALSE;
+        }
     }
-  else if (!gdk_region_empty (visible_region))
+  else
     {
-      GdkRectangle *rects;
-      int           n_rects;
-      int           i;
+      gfloat *c;
+      gint    i;
 
-      /* Limit to how many separate rectangles we'll draw; beyond this just
-       * fall back and draw the whole thing */
-#     define MAX_RECTS 16
+      /*
+       * The buffer is kept around between paints and only ever grows.
+       */
+      if (!coords)
+        coords = g_array_new (FALSE, FALSE, sizeof (gfloat));
 
-      /* Would be nice to be able to check the number of rects first */
-      gdk_region_get_rectangles (visible_region, &rects, &n_rects);
+      if (coords->len < (guint) n_rects * 8)
+        g_array_set_size (coords, n_rects * 8);
 
-      if (n_rects > MAX_RECTS)
-	{
-	  g_free (rects);
+      c = (gfloat *) coords->data;
 
-          if (priv->scaled_background)
+      if (priv->scaled_background)
+        {
+          for (i = 0; i < n_rects; i++)
             {
-              gfloat tx1, tx2, ty1, ty2;
-
-              tx1 = (0.5 - vw);
-              tx2 = (0.5 + vw);
-              ty1 = (0.5 - vh);
-              ty2 = (0.5 + vh);
-
-              cogl_rectangle_with_texture_coords (0, 0,
-                                                  alloc.x2 - alloc.x1,
-                                                  alloc.y2 - alloc.y1,
-                                                  tx1, ty1,
-                                                  tx2, ty2);
-              return TRUE;
-            }
+              GdkRectangle *rect = &rects[i];
 
-          /*
-           * This is the simple case; we return FALSE, allowing the paint to
-           * reach the normal texture paint method.
-           */
-          retval = FALSE;
-	}
-      else
-	{
-	  float coords[MAX_RECTS * 8];
-
-          if (priv->scaled_background)
-            {
-              for (i = 0; i < n_rects; i++)
-                {
-                  GdkRectangle *rect = &rects[i];
-
-                  /*
-                   * The texture coordinates are first normalized for the
-                   * allocation size, then scaled by the scaled texture width,
-                   * and finally translated by the scaled texture offset (which,
-                   * since the texture is centered, is 1/2 - half_size).
-                   */
-                  gfloat x1 = rect->x / aw;
-                  gfloat x2 = (rect->x + rect->width) / aw;
-                  gfloat y1 = rect->y / ah;
-                  gfloat y2 = (rect->y + rect->height)/ ah;
-
-                  x1 = x1 * 2 * vw + (0.5 - vw);
-                  x2 = x2 * 2 * vw + (0.5 - vw);
-                  y1 = y1 * 2 * vh + (0.5 - vh);
-                  y2 = y2 * 2 * vh + (0.5 - vh);
-
-                  coords[i * 8 + 0] = rect->x;
-                  coords[i * 8 + 1] = rect->y;
-                  coords[i * 8 + 2] = rect->x + rect->width;
-                  coords[i * 8 + 3] = rect->y + rect->height;
-                  coords[i * 8 + 4] = x1;
-                  coords[i * 8 + 5] = y1;
-                  coords[i * 8 + 6] = x2;
-                  coords[i * 8 + 7] = y2;
-                }
+              /*
+               * The texture coordinates are first normalized for the
+               * allocation size, then scaled by the scaled texture width,
+               * and finally translated by the scaled texture offset (which,
+               * since the texture is centered, is 1/2 - half_size).
+               */
+              gfloat x1 = rect->x / aw;
+              gfloat x2 = (rect->x + rect->width) / aw;
+              gfloat y1 = rect->y / ah;
+              gfloat y2 = (rect->y + rect->height)/ ah;
+
+              x1 = x1 * 2 * vw + (0.5 - vw);
+              x2 = x2 * 2 * vw + (0.5 - vw);
+              y1 = y1 * 2 * vh + (0.5 - vh);
+              y2 = y2 * 2 * vh + (0.5 - vh);
+
+              c[i * 8 + 0] = rect->x;
+              c[i * 8 + 1] = rect->y;
+              c[i * 8 + 2] = rect->x + rect->width;
+              c[i * 8 + 3] = rect->y + rect->height;
+              c[i * 8 + 4] = x1;
+              c[i * 8 + 5] = y1;
+              c[i * 8 + 6] = x2;
+              c[i * 8 + 7] = y2;
             }
-          else
+        }
+      else
+        {
+          for (i = 0; i < n_rects; i++)
             {
-              for (i = 0; i < n_rects; i++)
-                {
-                  GdkRectangle *rect = &rects[i];
-
-                  coords[i * 8 + 0] = rect->x;
-                  coords[i * 8 + 1] = rect->y;
-                  coords[i * 8 + 2] = rect->x + rect->width;
-                  coords[i * 8 + 3] = rect->y + rect->height;
-                  coords[i * 8 + 4] = rect->x / bw;
-                  coords[i * 8 + 5] = rect->y / bh;
-                  coords[i * 8 + 6] = (rect->x + rect->width)  / bw;
-                  coords[i * 8 + 7] = (rect->y + rect->height) / bh;
-                }
+              GdkRectangle *rect = &rects[i];
+
+              c[i * 8 + 0] = rect->x;
+              c[i * 8 + 1] = rect->y;
+              c[i * 8 + 2] = rect->x + rect->width;
+              c[i * 8 + 3] = rect->y + rect->height;
+              c[i * 8 + 4] = rect->x / bw;
+              c[i * 8 + 5] = rect->y / bh;
+              c[i * 8 + 6] = (rect->x + rect->width)  / bw;
+              c[i * 8 + 7] = (rect->y + rect->height) / bh;
             }
+        }
 
-	  g_free (rects);
-
-	  cogl_rectangles_with_texture_coords (coords, n_rects);
-	}
+      cogl_rectangles_with_texture_coords (c, n_rects);
     }
 
  finish_up:
-  gdk_region_destroy (visible_region);
+  g_free (rects);
   return retval;
 }
 
+/*
+ * Returns how many times each of the desktop background paint paths was
+ * taken since the plugin started; counts must point to an array of
+ * MNB_BG_PAINT_LAST elements.
+ */
+void
+meego_netbook_get_background_paint_counts (guint *counts)
+{
+  gint i;
+
+  for (i = 0; i < MNB_BG_PAINT_LAST; i++)
+    counts[i] = bg_paint_counts[i];
+}
+
 /*
  * Avoid painting the desktop background if it is completely occluded.
  */
@@ -2570,6 +2667,7 @@ static void
 desktop_background_paint (ClutterActor *background, MutterPlugin *plugin)
 {
   MetaScreen *screen;
+  gint64      start = mnb_paint_profiler_begin ();
 
   /*
    * Don't paint desktop background if fullscreen application is present.
@@ -2590,10 +2688,12 @@ desktop_background_paint (ClutterActor *background, MutterPlugin *plugin)
        * We have not painted the texture, so we leave without stoping
        * emission of the signal.
        */
+      mnb_paint_profiler_end (MNB_PAINT_STAGE_BACKGROUND, start);
       return;
     }
 
  finish_up:
+  mnb_paint_profiler_end (MNB_PAINT_STAGE_BACKGROUND, start);
   g_signal_stop_emission_by_name (background, "paint");
 }
 
@@ -2616,6 +2716,9 @@ setup_desktop_background (MutterPlugin *plugin, const gchar *filename)
 
   priv->desktop_tex = new_texture;
 
+  if (priv->bg_occlusion)
+    mnb_background_occlusion_invalidate (priv->bg_occlusion);
+
   if (old_texture)
     clutter_actor_destroy (old_texture);
 
@@ -2754,6 +2857,69 @@ desktop_background_init (MutterPlugin *plugin)
 #endif
 }
 
+static void
+instant_mode_changed_cb (GConfClient *client,
+                         guint        cnxn_id,
+                         GConfEntry  *entry,
+                         gpointer     data)
+{
+  MutterPlugin              *plugin = MUTTER_PLUGIN (data);
+  MeegoNetbookPluginPrivate *priv   = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
+  GConfValue                *value;
+
+  if (!entry)
+    return;
+
+  value = gconf_entry_get_value (entry);
+
+  priv->instant_mode =
+    value && value->type == GCONF_VALUE_BOOL && gconf_value_get_bool (value);
+
+  g_debug ("Instant mode %s", priv->instant_mode ? "on" : "off");
+}
+
+/*
+ * The instant mode replaces the show/hide animations of the Toolbar and
+ * panels with immediate placement, for hardware where the animations cannot
+ * run at a reasonable frame rate; it can be toggled at runtime.
+ */
+static void
+instant_mode_init (MutterPlugin *plugin)
+{
+  MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
+  GError *error = NULL;
+
+  priv->instant_mode = gconf_client_get_bool (priv->gconf_client,
+                                              KEY_INSTANT_MODE,
+                                              NULL);
+
+  gconf_client_add_dir (priv->gconf_client,
+                        "/desktop/meego",
+                        GCONF_CLIENT_PRELOAD_NONE,
+                        &error);
+
+  if (error)
+    {
+      g_warning (G_STRLOC ": Error when adding directory for notification: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+
+  gconf_client_notify_add (priv->gconf_client,
+                           KEY_INSTANT_MODE,
+                           instant_mode_changed_cb,
+                           plugin,
+                           NULL,
+                           &error);
+
+  if (error)
+    {
+      g_warning (G_STRLOC ": Error when adding key for notification: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+}
+
 /*
  * Core of the plugin init function, called for initial initialization and
  * by the reload() function. Returns TRUE on success.
@@ -2975,6 +3141,18 @@ meego_netbook_use_netbook_mode (MutterPlugin *plugin)
   return priv->netbook_mode;
 }
 
+/*
+ * Returns TRUE if the Toolbar and panels should be placed immediately, rather
+ * than animated, when shown and hidden.
+ */
+gboolean
+meego_netbook_use_instant_mode (MutterPlugin *plugin)
+{
+  MeegoNetbookPluginPrivate *priv = MEEGO_NETBOOK_PLUGIN (plugin)->priv;
+
+  return priv->instant_mode;
+}
+
 guint32
 meego_netbook_get_compositor_option_flags (void)
 {
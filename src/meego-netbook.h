@@ -35,6 +35,7 @@
 #include "presence/gsm-presence.h"
 
 #include "mnb-input-manager.h"
+#include "mnb-background-occlusion.h"
 
 #define MNB_DBG_MARK() \
   g_debug (G_STRLOC ":%s", __FUNCTION__)        \
@@ -52,8 +53,25 @@ typedef enum
   MNB_OPTION_DISABLE_WS_CLAMP          = 1 << 1,
   MNB_OPTION_DISABLE_PANEL_RESTART     = 1 << 2,
   MNB_OPTION_COMPOSITE_FULLSCREEN_APPS = 1 << 3,
+  MNB_OPTION_PREWARM_PANELS            = 1 << 4,
+  MNB_OPTION_LAZY_PANELS               = 1 << 5,
+  MNB_OPTION_FANCY_BIN_PATH_CLIP       = 1 << 6,
 } MnbOptionFlag;
 
+/*
+ * Paths taken by the desktop background paint.
+ */
+typedef enum
+{
+  MNB_BG_PAINT_COMPLETE = 0, /* whole texture, as requested            */
+  MNB_BG_PAINT_PARTIAL,      /* only the parts not occluded by windows */
+  MNB_BG_PAINT_FALLBACK,     /* whole texture, too much of it visible  */
+  MNB_BG_PAINT_SKIPPED,      /* nothing visible                        */
+
+  /* Must be last */
+  MNB_BG_PAINT_LAST
+} MnbBackgroundPaintPath;
+
 #define MEEGO_TYPE_NETBOOK_PLUGIN            (meego_netbook_plugin_get_type ())
 #define MEEGO_NETBOOK_PLUGIN(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEEGO_TYPE_NETBOOK_PLUGIN, MeegoNetbookPlugin))
 #define MEEGO_NETBOOK_PLUGIN_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  MEEGO_TYPE_NETBOOK_PLUGIN, MeegoNetbookPluginClass))
@@ -101,9 +119,11 @@ struct _MeegoNetbookPluginPrivate
   gboolean               netbook_mode        : 1;
   gboolean               screen_saver_dpms   : 1;
   gboolean               scaled_background   : 1;
+  gboolean               instant_mode        : 1;
 
   /* Background desktop texture */
   ClutterActor          *desktop_tex;
+  MnbBackgroundOcclusion *bg_occlusion;
 
   MutterPluginInfo       info;
 
@@ -119,6 +139,9 @@ struct _MeegoNetbookPluginPrivate
 
   int                    saver_base;
   int                    saver_error;
+
+  int                    shape_base;
+  int                    shape_error;
 };
 
 GType meego_netbook_plugin_get_type (void);
@@ -183,6 +206,9 @@ meego_netbook_activate_mutter_window (MutterWindow *mcw);
 gboolean
 meego_netbook_use_netbook_mode (MutterPlugin *plugin);
 
+gboolean
+meego_netbook_use_instant_mode (MutterPlugin *plugin);
+
 guint32
 meego_netbook_get_compositor_option_flags (void);
 
@@ -196,4 +222,7 @@ meego_netbook_set_struts (MutterPlugin *plugin,
                            gint          top,
                            gint          bottom);
 
+void
+meego_netbook_get_background_paint_counts (guint *counts);
+
 #endif
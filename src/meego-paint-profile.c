@@ -0,0 +1,110 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* meego-paint-profile.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Dumps the compositor paint profile (see mnb-paint-profiler.c) obtained via
+ * the Toolbar D-Bus interface.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <dbus/dbus-glib.h>
+#include <meego-panel/mpl-panel-common.h>
+
+#include "mnb-toolbar-dbus-bindings.h"
+
+int
+main (int argc, char **argv)
+{
+  gboolean        reset    = FALSE;
+  gint            interval = 0;
+  GOptionEntry    options[] = {
+    { "reset", 'r', 0, G_OPTION_ARG_NONE, &reset,
+      "Reset the statistics after dumping them", NULL },
+    { "interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+      "Dump repeatedly every <seconds>", "<seconds>" },
+    { NULL }
+  };
+
+  GOptionContext  *context;
+  DBusGConnection *conn;
+  DBusGProxy      *proxy;
+  GError          *error = NULL;
+
+  g_type_init ();
+
+  context = g_option_context_new ("- dump compositor paint profile");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (!(conn = dbus_g_bus_get (DBUS_BUS_SESSION, &error)))
+    {
+      g_printerr ("Unable to connect to the session bus: %s\n",
+                  error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  proxy = dbus_g_proxy_new_for_name (conn,
+                                     MPL_TOOLBAR_DBUS_NAME,
+                                     MPL_TOOLBAR_DBUS_PATH,
+                                     MPL_TOOLBAR_DBUS_INTERFACE);
+
+  do
+    {
+      gchar *profile = NULL;
+
+      if (!com_meego_UX_Shell_Toolbar_get_paint_profile (proxy, reset,
+                                                         &profile, &error))
+        {
+          g_printerr ("GetPaintProfile failed: %s\n", error->message);
+          g_error_free (error);
+          g_object_unref (proxy);
+          return EXIT_FAILURE;
+        }
+
+      fputs (profile, stdout);
+      fflush (stdout);
+      g_free (profile);
+
+      if (interval > 0)
+        {
+          putchar ('\n');
+          sleep (interval);
+        }
+    }
+  while (interval > 0);
+
+  g_object_unref (proxy);
+
+  return EXIT_SUCCESS;
+}
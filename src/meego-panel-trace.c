@@ -0,0 +1,426 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* meego-panel-trace.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Merges the panel show/hide traces written by the compositor and the panels
+ * when MEEGO_PANEL_TRACE_DIR is set (see mnb-panel-oop.c and
+ * mpl-panel-client.c), and prints the latency of each stage of the requests,
+ * per panel.
+ *
+ * The trace files contain one event per line:
+ *
+ *   <monotonic time in us> <panel> <trace id> <event>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+typedef struct
+{
+  gint64  time;
+  gchar  *event;
+} TraceEvent;
+
+typedef struct
+{
+  gchar  *panel;
+  guint   id;
+  GArray *events;
+} Trace;
+
+typedef struct
+{
+  gchar   *hop;   /* "<event> -> <event>" */
+  guint    count;
+  gint64   total;
+  gint64   max;
+} HopStats;
+
+typedef struct
+{
+  gchar     *key; /* "<panel> <show|hide>" */
+  guint      n_traces;
+  gint64     total;
+  gint64     max;
+  GPtrArray *hops;
+} PanelStats;
+
+static void
+trace_free (gpointer data)
+{
+  Trace *trace = data;
+  guint  i;
+
+  for (i = 0; i < trace->events->len; i++)
+    g_free (g_array_index (trace->events, TraceEvent, i).event);
+
+  g_array_free (trace->events, TRUE);
+  g_free (trace->panel);
+  g_slice_free (Trace, trace);
+}
+
+static void
+hop_stats_free (gpointer data)
+{
+  HopStats *hs = data;
+
+  g_free (hs->hop);
+  g_slice_free (HopStats, hs);
+}
+
+static void
+panel_stats_free (gpointer data)
+{
+  PanelStats *ps = data;
+
+  g_free (ps->key);
+  g_ptr_array_free (ps->hops, TRUE);
+  g_slice_free (PanelStats, ps);
+}
+
+static gint
+event_compare (gconstpointer a, gconstpointer b)
+{
+  const TraceEvent *ea = a;
+  const TraceEvent *eb = b;
+
+  if (ea->time < eb->time)
+    return -1;
+
+  return ea->time > eb->time;
+}
+
+static gboolean
+load_file (const gchar *path, GHashTable *traces, GError **error)
+{
+  gchar  *contents;
+  gchar **lines;
+  gchar **l;
+
+  if (!g_file_get_contents (path, &contents, NULL, error))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (l = lines; *l; l++)
+    {
+      gchar       panel[256];
+      gchar       event[256];
+      guint       id;
+      gint64      time;
+      long long   t;
+      gchar      *key;
+      Trace      *trace;
+      TraceEvent  te;
+
+      if (sscanf (*l, "%lld %255s %u %255s", &t, panel, &id, event) != 4)
+        continue;
+
+      time = t;
+      key  = g_strdup_printf ("%s %u", panel, id);
+
+      if (!(trace = g_hash_table_lookup (traces, key)))
+        {
+          trace = g_slice_new0 (Trace);
+          trace->panel  = g_strdup (panel);
+          trace->id     = id;
+          trace->events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+
+          g_hash_table_insert (traces, key, trace);
+        }
+      else
+        g_free (key);
+
+      te.time  = time;
+      te.event = g_strdup (event);
+
+      g_array_append_val (trace->events, te);
+    }
+
+  g_strfreev (lines);
+
+  return TRUE;
+}
+
+static const gchar *
+trace_kind (Trace *trace)
+{
+  guint i;
+
+  for (i = 0; i < trace->events->len; i++)
+    {
+      const gchar *event = g_array_index (trace->events, TraceEvent, i).event;
+
+      if (g_str_has_prefix (event, "show"))
+        return "show";
+
+      if (g_str_has_prefix (event, "hide"))
+        return "hide";
+    }
+
+  return "unknown";
+}
+
+static PanelStats *
+panel_stats_get (GHashTable *stats, GPtrArray *order, Trace *trace)
+{
+  PanelStats *ps;
+  gchar      *key;
+
+  key = g_strdup_printf ("%s %s", trace->panel, trace_kind (trace));
+
+  if ((ps = g_hash_table_lookup (stats, key)))
+    {
+      g_free (key);
+      return ps;
+    }
+
+  ps = g_slice_new0 (PanelStats);
+  ps->key  = key;
+  ps->hops = g_ptr_array_new_with_free_func (hop_stats_free);
+
+  g_hash_table_insert (stats, ps->key, ps);
+  g_ptr_array_add (order, ps);
+
+  return ps;
+}
+
+static void
+panel_stats_add_hop (PanelStats *ps, const gchar *from, const gchar *to,
+                     gint64 delta)
+{
+  HopStats *hs = NULL;
+  gchar    *hop;
+  guint     i;
+
+  hop = g_strdup_printf ("%s -> %s", from, to);
+
+  for (i = 0; i < ps->hops->len; i++)
+    {
+      HopStats *h = g_ptr_array_index (ps->hops, i);
+
+      if (!strcmp (h->hop, hop))
+        {
+          hs = h;
+          break;
+        }
+    }
+
+  if (!hs)
+    {
+      hs = g_slice_new0 (HopStats);
+      hs->hop = hop;
+      g_ptr_array_add (ps->hops, hs);
+    }
+  else
+    g_free (hop);
+
+  hs->count++;
+  hs->total += delta;
+
+  if (delta > hs->max)
+    hs->max = delta;
+}
+
+static gint
+trace_compare (gconstpointer a, gconstpointer b)
+{
+  Trace *ta = *(Trace **) a;
+  Trace *tb = *(Trace **) b;
+  gint   r;
+
+  if ((r = strcmp (ta->panel, tb->panel)))
+    return r;
+
+  return event_compare (&g_array_index (ta->events, TraceEvent, 0),
+                        &g_array_index (tb->events, TraceEvent, 0));
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean        verbose = FALSE;
+  gchar          *dir     = NULL;
+  GOptionEntry    options[] = {
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+      "Print every trace, not just the summary", NULL },
+    { "dir", 'd', 0, G_OPTION_ARG_FILENAME, &dir,
+      "Directory with the trace files (default $MEEGO_PANEL_TRACE_DIR)",
+      "<dir>" },
+    { NULL }
+  };
+
+  GOptionContext *context;
+  GError         *error = NULL;
+  GDir           *gdir;
+  const gchar    *name;
+  GHashTable     *traces;
+  GHashTable     *stats;
+  GPtrArray      *order;
+  GPtrArray      *sorted;
+  GHashTableIter  iter;
+  gpointer        value;
+  guint           i, j;
+
+  context = g_option_context_new ("- merge panel show/hide traces");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (!dir)
+    dir = g_strdup (g_getenv ("MEEGO_PANEL_TRACE_DIR"));
+
+  if (!dir)
+    {
+      g_printerr ("No trace directory given, and MEEGO_PANEL_TRACE_DIR "
+                  "is not set\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!(gdir = g_dir_open (dir, 0, &error)))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  traces = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, trace_free);
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      gchar *path;
+
+      if (!g_str_has_suffix (name, ".trace"))
+        continue;
+
+      path = g_build_filename (dir, name, NULL);
+
+      if (!load_file (path, traces, &error))
+        {
+          g_printerr ("%s\n", error->message);
+          g_clear_error (&error);
+        }
+
+      g_free (path);
+    }
+
+  g_dir_close (gdir);
+
+  /*
+   * Order the events within each trace, and the traces by panel and time.
+   */
+  sorted = g_ptr_array_new ();
+
+  g_hash_table_iter_init (&iter, traces);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      Trace *trace = value;
+
+      g_array_sort (trace->events, event_compare);
+      g_ptr_array_add (sorted, trace);
+    }
+
+  g_ptr_array_sort (sorted, trace_compare);
+
+  stats = g_hash_table_new (g_str_hash, g_str_equal);
+  order = g_ptr_array_new_with_free_func (panel_stats_free);
+
+  for (i = 0; i < sorted->len; i++)
+    {
+      Trace      *trace = g_ptr_array_index (sorted, i);
+      PanelStats *ps    = panel_stats_get (stats, order, trace);
+      TraceEvent *first = &g_array_index (trace->events, TraceEvent, 0);
+      TraceEvent *last;
+      gint64      total;
+
+      last  = &g_array_index (trace->events, TraceEvent,
+                              trace->events->len - 1);
+      total = last->time - first->time;
+
+      ps->n_traces++;
+      ps->total += total;
+
+      if (total > ps->max)
+        ps->max = total;
+
+      if (verbose)
+        printf ("%s %u: %.1f ms\n", trace->panel, trace->id, total / 1000.0);
+
+      for (j = 0; j < trace->events->len; j++)
+        {
+          TraceEvent *te = &g_array_index (trace->events, TraceEvent, j);
+
+          if (verbose)
+            printf ("  %9.1f %s\n", (te->time - first->time) / 1000.0,
+                    te->event);
+
+          if (j > 0)
+            {
+              TraceEvent *prev = te - 1;
+
+              panel_stats_add_hop (ps, prev->event, te->event,
+                                   te->time - prev->time);
+            }
+        }
+    }
+
+  if (verbose && sorted->len)
+    putchar ('\n');
+
+  printf ("# panel request count mean-ms max-ms\n");
+  printf ("#   hop count mean-ms max-ms\n");
+
+  for (i = 0; i < order->len; i++)
+    {
+      PanelStats *ps = g_ptr_array_index (order, i);
+
+      printf ("%s %u %.1f %.1f\n", ps->key, ps->n_traces,
+              ps->total / 1000.0 / ps->n_traces, ps->max / 1000.0);
+
+      for (j = 0; j < ps->hops->len; j++)
+        {
+          HopStats *hs = g_ptr_array_index (ps->hops, j);
+
+          printf ("  %s %u %.1f %.1f\n", hs->hop, hs->count,
+                  hs->total / 1000.0 / hs->count, hs->max / 1000.0);
+        }
+    }
+
+  g_ptr_array_free (order, TRUE);
+  g_hash_table_destroy (stats);
+  g_ptr_array_free (sorted, TRUE);
+  g_hash_table_destroy (traces);
+  g_free (dir);
+
+  return EXIT_SUCCESS;
+}
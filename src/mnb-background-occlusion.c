@@ -0,0 +1,403 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-background-occlusion.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "mnb-background-occlusion.h"
+
+/*
+ * Cached occlusion of the desktop background.
+ *
+ * The desktop background sits beneath all windows, so the part of it that
+ * needs painting is simply the screen area minus the union of the obscured
+ * regions of all visible, opaque windows; the stacking order of the windows
+ * is irrelevant. This allows us to keep the visible region around between
+ * paints, and when a single window changes, patch it up without looking at
+ * the rest of the stack:
+ *
+ *   - the area the window used to cover, minus what it covers now, is added
+ *     back to the visible region, less anything other windows still cover,
+ *
+ *   - the area the window covers now is subtracted from the visible region.
+ *
+ * Each window's contribution (its obscured region in screen coordinates) is
+ * stored so that it does not have to be recomputed for the first step. The
+ * cache is rebuilt from scratch only when explicitely invalidated (e.g., on
+ * screen size change, workspace switch, or when a window changes its shape).
+ *
+ * Windows that are scaled (as they are by the map, minimize and maximize
+ * effects) are treated as not occluding anything, so no effect needs to be
+ * tracked separately; the window opacity is taken to be its paint opacity, so
+ * the window group is watched as well.
+ */
+
+GdkRegion *mutter_window_get_obscured_region (MutterWindow *cw);
+
+typedef struct
+{
+  MutterWindow *mcw;
+  GdkRegion    *region; /* screen-relative obscured region, or NULL */
+} MnbOcclusionWindow;
+
+struct MnbBackgroundOcclusion
+{
+  MetaScreen   *screen;
+  ClutterActor *window_group;
+  GHashTable   *windows;
+  GdkRegion    *visible_region; /* NULL when the cache is not valid */
+};
+
+static void mnb_background_occlusion_window_changed_cb (ClutterActor           *actor,
+                                                        GParamSpec             *pspec,
+                                                        MnbBackgroundOcclusion *occ);
+static void mnb_background_occlusion_window_destroy_cb (ClutterActor           *actor,
+                                                        MnbBackgroundOcclusion *occ);
+static void mnb_background_occlusion_group_changed_cb (ClutterActor           *actor,
+                                                       GParamSpec             *pspec,
+                                                       MnbBackgroundOcclusion *occ);
+
+static void
+mnb_occlusion_window_free (gpointer data)
+{
+  MnbOcclusionWindow *ow = data;
+
+  if (ow->region)
+    gdk_region_destroy (ow->region);
+
+  g_slice_free (MnbOcclusionWindow, ow);
+}
+
+MnbBackgroundOcclusion *
+mnb_background_occlusion_new (MetaScreen *screen)
+{
+  MnbBackgroundOcclusion *occ = g_new0 (MnbBackgroundOcclusion, 1);
+
+  occ->screen  = screen;
+  occ->windows = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                        NULL, mnb_occlusion_window_free);
+
+  occ->window_group = mutter_get_window_group_for_screen (screen);
+
+  g_signal_connect (occ->window_group, "notify::opacity",
+                    G_CALLBACK (mnb_background_occlusion_group_changed_cb),
+                    occ);
+  g_signal_connect (occ->window_group, "notify::visible",
+                    G_CALLBACK (mnb_background_occlusion_group_changed_cb),
+                    occ);
+
+  return occ;
+}
+
+void
+mnb_background_occlusion_free (MnbBackgroundOcclusion *occ)
+{
+  GHashTableIter iter;
+  gpointer       key;
+
+  g_signal_handlers_disconnect_matched (occ->window_group, G_SIGNAL_MATCH_DATA,
+                                        0, 0, NULL, NULL, occ);
+
+  g_hash_table_iter_init (&iter, occ->windows);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    g_signal_handlers_disconnect_matched (key, G_SIGNAL_MATCH_DATA,
+                                          0, 0, NULL, NULL, occ);
+
+  g_hash_table_destroy (occ->windows);
+
+  if (occ->visible_region)
+    gdk_region_destroy (occ->visible_region);
+
+  g_free (occ);
+}
+
+/*
+ * Calculates the region of the screen the window covers, or NULL if it does
+ * not occlude anything.
+ */
+static GdkRegion *
+mnb_background_occlusion_window_region (MnbBackgroundOcclusion *occ,
+                                        MutterWindow           *mcw)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (mcw);
+  GdkRectangle  screen_rect = { 0 };
+  GdkRegion    *obscured_region;
+  GdkRegion    *region;
+  GdkRegion    *screen_region;
+  gfloat        x, y;
+  gfloat        anchor_x, anchor_y;
+
+  if (!CLUTTER_ACTOR_IS_VISIBLE (actor))
+    return NULL;
+
+  /*
+   * Same as in MutterWindowGroup, a transformed window is not considered to
+   * occlude anything; this also covers windows being animated by the effects.
+   */
+  if (clutter_actor_is_scaled (actor) || clutter_actor_is_rotated (actor))
+    return NULL;
+
+  if (clutter_actor_get_paint_opacity (actor) != 0xff)
+    return NULL;
+
+  if (!(obscured_region = mutter_window_get_obscured_region (mcw)))
+    return NULL;
+
+  region = gdk_region_copy (obscured_region);
+
+  clutter_actor_get_position (actor, &x, &y);
+  clutter_actor_get_anchor_point (actor, &anchor_x, &anchor_y);
+  gdk_region_offset (region, (gint)(x - anchor_x), (gint)(y - anchor_y));
+
+  meta_screen_get_size (occ->screen, &screen_rect.width, &screen_rect.height);
+  screen_region = gdk_region_rectangle (&screen_rect);
+  gdk_region_intersect (region, screen_region);
+  gdk_region_destroy (screen_region);
+
+  if (gdk_region_empty (region))
+    {
+      gdk_region_destroy (region);
+      return NULL;
+    }
+
+  return region;
+}
+
+static MnbOcclusionWindow *
+mnb_background_occlusion_ensure_window (MnbBackgroundOcclusion *occ,
+                                        MutterWindow           *mcw)
+{
+  MnbOcclusionWindow *ow;
+
+  if ((ow = g_hash_table_lookup (occ->windows, mcw)))
+    return ow;
+
+  ow = g_slice_new0 (MnbOcclusionWindow);
+  ow->mcw = mcw;
+
+  g_hash_table_insert (occ->windows, mcw, ow);
+
+  g_signal_connect (mcw, "notify::allocation",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::opacity",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::visible",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::scale-x",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::scale-y",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::anchor-x",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "notify::anchor-y",
+                    G_CALLBACK (mnb_background_occlusion_window_changed_cb),
+                    occ);
+  g_signal_connect (mcw, "destroy",
+                    G_CALLBACK (mnb_background_occlusion_window_destroy_cb),
+                    occ);
+
+  return ow;
+}
+
+/*
+ * Replaces the contribution of a single window to the occlusion with new_region
+ * (which is adopted), patching up the cached visible region.
+ */
+static void
+mnb_background_occlusion_patch (MnbBackgroundOcclusion *occ,
+                                MnbOcclusionWindow     *ow,
+                                GdkRegion              *new_region)
+{
+  GdkRegion *old_region = ow->region;
+
+  ow->region = new_region;
+
+  if (!occ->visible_region)
+    {
+      if (old_region)
+        gdk_region_destroy (old_region);
+
+      return;
+    }
+
+  if (old_region && new_region && gdk_region_equal (old_region, new_region))
+    {
+      gdk_region_destroy (old_region);
+      return;
+    }
+
+  if (old_region)
+    {
+      GHashTableIter  iter;
+      gpointer        value;
+      GdkRegion      *exposed = old_region;
+
+      if (new_region)
+        gdk_region_subtract (exposed, new_region);
+
+      g_hash_table_iter_init (&iter, occ->windows);
+      while (!gdk_region_empty (exposed) &&
+             g_hash_table_iter_next (&iter, NULL, &value))
+        {
+          MnbOcclusionWindow *other = value;
+
+          if (other != ow && other->region)
+            gdk_region_subtract (exposed, other->region);
+        }
+
+      gdk_region_union (occ->visible_region, exposed);
+      gdk_region_destroy (exposed);
+    }
+
+  if (new_region)
+    gdk_region_subtract (occ->visible_region, new_region);
+}
+
+static void
+mnb_background_occlusion_window_changed_cb (ClutterActor           *actor,
+                                            GParamSpec             *pspec,
+                                            MnbBackgroundOcclusion *occ)
+{
+  MutterWindow       *mcw = MUTTER_WINDOW (actor);
+  MnbOcclusionWindow *ow  = g_hash_table_lookup (occ->windows, mcw);
+
+  if (!ow || !occ->visible_region)
+    return;
+
+  mnb_background_occlusion_patch (occ, ow,
+                         mnb_background_occlusion_window_region (occ, mcw));
+}
+
+static void
+mnb_background_occlusion_window_destroy_cb (ClutterActor           *actor,
+                                            MnbBackgroundOcclusion *occ)
+{
+  MnbOcclusionWindow *ow = g_hash_table_lookup (occ->windows, actor);
+
+  if (!ow)
+    return;
+
+  mnb_background_occlusion_patch (occ, ow, NULL);
+
+  g_signal_handlers_disconnect_matched (actor, G_SIGNAL_MATCH_DATA,
+                                        0, 0, NULL, NULL, occ);
+
+  g_hash_table_remove (occ->windows, actor);
+}
+
+/*
+ * The paint opacity and visibility of all windows depends on the window group.
+ */
+static void
+mnb_background_occlusion_group_changed_cb (ClutterActor           *actor,
+                                           GParamSpec             *pspec,
+                                           MnbBackgroundOcclusion *occ)
+{
+  mnb_background_occlusion_invalidate (occ);
+}
+
+/*
+ * Starts tracking the window (e.g., when it is mapped); if the window is
+ * already tracked, its contribution is refreshed.
+ */
+void
+mnb_background_occlusion_track_window (MnbBackgroundOcclusion *occ,
+                                       MutterWindow           *mcw)
+{
+  MnbOcclusionWindow *ow;
+
+  g_return_if_fail (occ && MUTTER_IS_WINDOW (mcw));
+
+  ow = mnb_background_occlusion_ensure_window (occ, mcw);
+
+  mnb_background_occlusion_patch (occ, ow,
+                         mnb_background_occlusion_window_region (occ, mcw));
+}
+
+/*
+ * Forces complete recalculation of the occlusion on the next paint.
+ */
+void
+mnb_background_occlusion_invalidate (MnbBackgroundOcclusion *occ)
+{
+  g_return_if_fail (occ);
+
+  if (occ->visible_region)
+    {
+      gdk_region_destroy (occ->visible_region);
+      occ->visible_region = NULL;
+    }
+}
+
+static void
+mnb_background_occlusion_rebuild (MnbBackgroundOcclusion *occ)
+{
+  GList        *l;
+  GdkRectangle  screen_rect = { 0 };
+
+  /* Start off with the full screen area (for a multihead setup, we
+   * might want to use a more accurate union of the monitors to avoid
+   * painting in holes from mismatched monitor sizes. That's just an
+   * optimization, however.)
+   */
+  meta_screen_get_size (occ->screen, &screen_rect.width, &screen_rect.height);
+  occ->visible_region = gdk_region_rectangle (&screen_rect);
+
+  for (l = mutter_get_windows (occ->screen); l; l = l->next)
+    {
+      MutterWindow       *mcw;
+      MnbOcclusionWindow *ow;
+
+      if (!MUTTER_IS_WINDOW (l->data))
+        continue;
+
+      mcw = l->data;
+      ow  = mnb_background_occlusion_ensure_window (occ, mcw);
+
+      if (ow->region)
+        gdk_region_destroy (ow->region);
+
+      ow->region = mnb_background_occlusion_window_region (occ, mcw);
+
+      if (ow->region)
+        gdk_region_subtract (occ->visible_region, ow->region);
+    }
+}
+
+/*
+ * Returns the visible region of the background that needs to be painted, or
+ * NULL, if the entire area needs to be painted. The region is owned by the
+ * tracker and must not be modified or freed.
+ */
+const GdkRegion *
+mnb_background_occlusion_get_visible_region (MnbBackgroundOcclusion *occ)
+{
+  g_return_val_if_fail (occ, NULL);
+
+  if (!occ->visible_region)
+    mnb_background_occlusion_rebuild (occ);
+
+  return occ->visible_region;
+}
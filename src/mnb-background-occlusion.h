@@ -0,0 +1,38 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-background-occlusion.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef MNB_BACKGROUND_OCCLUSION_H
+#define MNB_BACKGROUND_OCCLUSION_H
+
+#include <mutter-plugin.h>
+#include <gdk/gdk.h>
+
+typedef struct MnbBackgroundOcclusion MnbBackgroundOcclusion;
+
+MnbBackgroundOcclusion *mnb_background_occlusion_new     (MetaScreen *screen);
+void                    mnb_background_occlusion_free    (MnbBackgroundOcclusion *occ);
+void                    mnb_background_occlusion_track_window (MnbBackgroundOcclusion *occ,
+                                                               MutterWindow           *mcw);
+void                    mnb_background_occlusion_invalidate (MnbBackgroundOcclusion *occ);
+const GdkRegion        *mnb_background_occlusion_get_visible_region (MnbBackgroundOcclusion *occ);
+
+#endif
@@ -0,0 +1,191 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-icon-cache.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "mnb-icon-cache.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+/*
+ * Process-wide cache of window icon textures.
+ *
+ * The alttab overlay and the notifications both display window icons; rather
+ * than each uploading the icon pixbuf into a new texture every time, the
+ * texture is created once per window, and the actors handed out share it.
+ *
+ * The cache entry remembers the pixbuf the texture was created from, so a
+ * change of the icon is picked up when the texture is next requested, no
+ * matter in what order the notify::icon handlers run; the handler of the
+ * cache itself merely releases the stale texture early. The entry lives as
+ * long as the window.
+ */
+
+typedef struct
+{
+  MetaWindow *window;
+  GdkPixbuf  *pixbuf;  /* the icon the texture was made from */
+  CoglHandle  texture;
+} MnbIconCacheEntry;
+
+static GHashTable *icon_cache = NULL;
+
+static void
+mnb_icon_cache_entry_clear (MnbIconCacheEntry *entry)
+{
+  if (entry->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (entry->texture);
+      entry->texture = COGL_INVALID_HANDLE;
+    }
+
+  if (entry->pixbuf)
+    {
+      g_object_unref (entry->pixbuf);
+      entry->pixbuf = NULL;
+    }
+}
+
+static void
+mnb_icon_cache_entry_free (gpointer data)
+{
+  MnbIconCacheEntry *entry = data;
+
+  mnb_icon_cache_entry_clear (entry);
+  g_slice_free (MnbIconCacheEntry, entry);
+}
+
+static void
+mnb_icon_cache_window_weak_notify (gpointer data, GObject *window)
+{
+  g_hash_table_remove (icon_cache, window);
+}
+
+static void
+mnb_icon_cache_icon_notify_cb (MetaWindow        *window,
+                               GParamSpec        *pspec,
+                               MnbIconCacheEntry *entry)
+{
+  mnb_icon_cache_entry_clear (entry);
+}
+
+static MnbIconCacheEntry *
+mnb_icon_cache_get_entry (MetaWindow *window)
+{
+  MnbIconCacheEntry *entry;
+
+  if (G_UNLIKELY (!icon_cache))
+    icon_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                        NULL, mnb_icon_cache_entry_free);
+
+  if ((entry = g_hash_table_lookup (icon_cache, window)))
+    return entry;
+
+  entry = g_slice_new0 (MnbIconCacheEntry);
+  entry->window  = window;
+  entry->texture = COGL_INVALID_HANDLE;
+
+  g_hash_table_insert (icon_cache, window, entry);
+
+  g_object_weak_ref (G_OBJECT (window), mnb_icon_cache_window_weak_notify,
+                     NULL);
+
+  /*
+   * The entry does not outlive the window, so there is no need to ever
+   * disconnect this.
+   */
+  g_signal_connect (window, "notify::icon",
+                    G_CALLBACK (mnb_icon_cache_icon_notify_cb), entry);
+
+  return entry;
+}
+
+/*
+ * Returns the texture for the icon of the given window, or
+ * COGL_INVALID_HANDLE if the window has no icon. The texture is owned by the
+ * cache; take a reference if you need to hold onto it.
+ */
+CoglHandle
+mnb_icon_cache_get_texture (MetaWindow *window)
+{
+  MnbIconCacheEntry *entry;
+  GdkPixbuf         *pixbuf = NULL;
+  gboolean           has_alpha;
+
+  g_return_val_if_fail (window, COGL_INVALID_HANDLE);
+
+  entry = mnb_icon_cache_get_entry (window);
+
+  g_object_get (window, "icon", &pixbuf, NULL);
+
+  if (pixbuf && pixbuf == entry->pixbuf &&
+      entry->texture != COGL_INVALID_HANDLE)
+    {
+      g_object_unref (pixbuf);
+      return entry->texture;
+    }
+
+  mnb_icon_cache_entry_clear (entry);
+
+  if (!pixbuf)
+    return COGL_INVALID_HANDLE;
+
+  has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+
+  entry->texture =
+    cogl_texture_new_from_data (gdk_pixbuf_get_width (pixbuf),
+                                gdk_pixbuf_get_height (pixbuf),
+                                COGL_TEXTURE_NONE,
+                                has_alpha ?
+                                COGL_PIXEL_FORMAT_RGBA_8888 :
+                                COGL_PIXEL_FORMAT_RGB_888,
+                                COGL_PIXEL_FORMAT_ANY,
+                                gdk_pixbuf_get_rowstride (pixbuf),
+                                gdk_pixbuf_get_pixels (pixbuf));
+
+  if (entry->texture == COGL_INVALID_HANDLE)
+    {
+      g_object_unref (pixbuf);
+      return COGL_INVALID_HANDLE;
+    }
+
+  entry->pixbuf = pixbuf;
+
+  return entry->texture;
+}
+
+/*
+ * Returns a new ClutterTexture showing the icon of the given window, or NULL
+ * if the window has no icon; the texture data is shared, so this is cheap.
+ */
+ClutterActor *
+mnb_icon_cache_get_icon (MetaWindow *window)
+{
+  CoglHandle    texture;
+  ClutterActor *icon;
+
+  if ((texture = mnb_icon_cache_get_texture (window)) == COGL_INVALID_HANDLE)
+    return NULL;
+
+  icon = clutter_texture_new ();
+  clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (icon), texture);
+
+  return icon;
+}
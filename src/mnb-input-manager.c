@@ -24,6 +24,8 @@
 
 #include "mnb-input-manager.h"
 
+#include <compositor-mutter.h>
+
 static MnbInputManager *mgr_singleton = NULL;
 static GQuark           quark_mir;
 
@@ -69,17 +71,29 @@ static GQuark           quark_mir;
  * pushed on the stack. The resulting region is used as the input shape for
  * stage window.
  *
+ * The regions on the stack are held client side (as GdkRegions), and the
+ * combined shape is also calculated client side; the X server only gets told
+ * about the result, using a single request, and only when the result differs
+ * from the shape it already has.
+ *
  * Each region remains on the stack until it is explicitely removed, using the
  * region ID obtained during the stack push.
  *
+ * Changes to the stack are normally not applied immediately; the stack is only
+ * marked as dirty, and the shape is calculated once, just before the next
+ * stage paint (during animations the allocation of the tracked actors changes
+ * many times per frame). Code that needs the shape to be in place right away
+ * can call mnb_input_manager_flush().
+ *
  * The individual functions are commented on below.
  */
 
 static void mnb_input_manager_apply_stack (void);
+static void mnb_input_manager_queue_apply (void);
 
 struct MnbInputRegion
 {
-  XserverRegion region;
+  GdkRegion    *region;
   gboolean      inverse;
   MnbInputLayer layer;
 };
@@ -88,9 +102,21 @@ struct MnbInputManager
 {
   MutterPlugin *plugin;
   GList        *layers[MNB_INPUT_LAYER_TOP + 1];
+  GdkRegion    *current_shape;  /* The shape last sent to the server */
   XserverRegion current_region;
+
+  ClutterActor *stage;
+  gulong        paint_id;
+  guint         idle_id;
+  gboolean      dirty    : 1;
 };
 
+static void
+mnb_input_manager_stage_paint_cb (ClutterActor *stage, gpointer data)
+{
+  mnb_input_manager_flush ();
+}
+
 void
 mnb_input_manager_create (MutterPlugin *plugin)
 {
@@ -101,7 +127,17 @@ mnb_input_manager_create (MutterPlugin *plugin)
 
   mgr_singleton = g_new0(MnbInputManager, 1);
 
-  mgr_singleton->plugin = plugin;
+  mgr_singleton->plugin   = plugin;
+  mgr_singleton->stage    =
+    mutter_get_stage_for_screen (mutter_plugin_get_screen (plugin));
+
+  /*
+   * Connect before the default handler, so that the shape gets applied before
+   * the frame is drawn.
+   */
+  mgr_singleton->paint_id =
+    g_signal_connect (mgr_singleton->stage, "paint",
+                      G_CALLBACK (mnb_input_manager_stage_paint_cb), NULL);
 
   quark_mir = g_quark_from_static_string ("MNB-INPUT-MANAGER-mir");
 }
@@ -117,6 +153,13 @@ mnb_input_manager_destroy ()
 
   xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
 
+  if (mgr_singleton->paint_id)
+    g_signal_handler_disconnect (mgr_singleton->stage,
+                                 mgr_singleton->paint_id);
+
+  if (mgr_singleton->idle_id)
+    g_source_remove (mgr_singleton->idle_id);
+
   for (i = 0; i <= MNB_INPUT_LAYER_TOP; ++i)
     {
       l = o = mgr_singleton->layers[i];
@@ -125,7 +168,7 @@ mnb_input_manager_destroy ()
         {
           MnbInputRegion *mir = l->data;
 
-          XFixesDestroyRegion (xdpy, mir->region);
+          gdk_region_destroy (mir->region);
 
           g_slice_free (MnbInputRegion, mir);
 
@@ -138,15 +181,41 @@ mnb_input_manager_destroy ()
   if (mgr_singleton->current_region)
     XFixesDestroyRegion (xdpy, mgr_singleton->current_region);
 
+  if (mgr_singleton->current_shape)
+    gdk_region_destroy (mgr_singleton->current_shape);
+
   g_free (mgr_singleton);
   mgr_singleton = NULL;
 }
 
+/*
+ * Replaces the area covered by the given region with a single rectangle.
+ */
+static void
+mnb_input_region_set_rectangle (MnbInputRegion *mir,
+                                gint            x,
+                                gint            y,
+                                gint            width,
+                                gint            height)
+{
+  GdkRectangle rect;
+
+  rect.x      = x;
+  rect.y      = y;
+  rect.width  = width;
+  rect.height = height;
+
+  if (mir->region)
+    gdk_region_destroy (mir->region);
+
+  mir->region = gdk_region_rectangle (&rect);
+}
+
 /*
  * mnb_input_manager_push_region ()
  *
  * Pushes region of the given dimensions onto the input region stack; this is
- * immediately reflected in the actual input shape.
+ * reflected in the actual input shape before the next frame is painted.
  *
  * x, y, width, height: region position and size (screen-relative)
  *
@@ -167,27 +236,19 @@ mnb_input_manager_push_region (gint          x,
                                gboolean      inverse,
                                MnbInputLayer layer)
 {
-  MnbInputRegion *mir  = g_slice_alloc (sizeof (MnbInputRegion));
-  Display        *xdpy;
-  XRectangle      rect;
+  MnbInputRegion *mir  = g_slice_new0 (MnbInputRegion);
 
   g_assert (mgr_singleton && layer >= 0 && layer <= MNB_INPUT_LAYER_TOP);
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
-  rect.x       = x;
-  rect.y       = y;
-  rect.width   = width;
-  rect.height  = height;
+  mnb_input_region_set_rectangle (mir, x, y, width, height);
 
   mir->inverse = inverse;
-  mir->region  = XFixesCreateRegion (xdpy, &rect, 1);
   mir->layer   = layer;
 
   mgr_singleton->layers[layer] =
     g_list_append (mgr_singleton->layers[layer], mir);
 
-  mnb_input_manager_apply_stack ();
+  mnb_input_manager_queue_apply ();
 
   return mir;
 }
@@ -195,8 +256,8 @@ mnb_input_manager_push_region (gint          x,
 /*
  * mnb_input_manager_remove_region ()
  *
- * Removes region previously pushed onto the stack with This change is
- * immediately applied to the actual input shape.
+ * Removes region previously pushed onto the stack; this change is applied to
+ * the actual input shape before the next frame is painted.
  *
  * mir: the region ID returned by mnb_input_manager_push_region().
  */
@@ -204,7 +265,7 @@ void
 mnb_input_manager_remove_region (MnbInputRegion  *mir)
 {
   mnb_input_manager_remove_region_without_update (mir);
-  mnb_input_manager_apply_stack ();
+  mnb_input_manager_queue_apply ();
 }
 
 /*
@@ -212,21 +273,17 @@ mnb_input_manager_remove_region (MnbInputRegion  *mir)
  *
  * Removes region previously pushed onto the stack.  This changes does not
  * immediately filter into the actual input shape; this is useful if you need to
- * replace an existing region, as it saves round trip to the server.
+ * replace an existing region, as it saves recalculating the shape.
  *
  * mir: the region ID returned by mnb_input_manager_push_region().
  */
 void
 mnb_input_manager_remove_region_without_update (MnbInputRegion *mir)
 {
-  Display *xdpy;
-
   g_assert (mgr_singleton);
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
   if (mir->region)
-    XFixesDestroyRegion (xdpy, mir->region);
+    gdk_region_destroy (mir->region);
 
   mgr_singleton->layers[mir->layer]
     = g_list_remove (mgr_singleton->layers[mir->layer], mir);
@@ -245,16 +302,22 @@ mnb_input_manager_apply_stack (void)
   Display       *xdpy;
   GList         *l;
   gint           i;
-  XserverRegion  result;
+  GdkRegion     *result;
+  GdkRectangle  *rects;
+  gint           n_rects;
+  XRectangle    *xrects;
 
   g_assert (mgr_singleton);
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
+  mgr_singleton->dirty = FALSE;
 
-  if (mgr_singleton->current_region)
-    XFixesDestroyRegion (xdpy, mgr_singleton->current_region);
+  if (mgr_singleton->idle_id)
+    {
+      g_source_remove (mgr_singleton->idle_id);
+      mgr_singleton->idle_id = 0;
+    }
 
-  result = mgr_singleton->current_region = XFixesCreateRegion (xdpy, NULL, 0);
+  result = gdk_region_new ();
 
   for (i = 0; i <= MNB_INPUT_LAYER_TOP; ++i)
     {
@@ -268,15 +331,104 @@ mnb_input_manager_apply_stack (void)
           MnbInputRegion *mir = l->data;
 
           if (mir->inverse)
-            XFixesSubtractRegion (xdpy, result, result, mir->region);
+            gdk_region_subtract (result, mir->region);
           else
-            XFixesUnionRegion (xdpy, result, result, mir->region);
+            gdk_region_union (result, mir->region);
 
           l = l->next;
         }
     }
 
-  mutter_plugin_set_stage_input_region (mgr_singleton->plugin, result);
+  /*
+   * Nothing to do if the shape is the one the server already has.
+   */
+  if (mgr_singleton->current_shape &&
+      gdk_region_equal (result, mgr_singleton->current_shape))
+    {
+      gdk_region_destroy (result);
+      return;
+    }
+
+  if (mgr_singleton->current_shape)
+    gdk_region_destroy (mgr_singleton->current_shape);
+
+  mgr_singleton->current_shape = result;
+
+  gdk_region_get_rectangles (result, &rects, &n_rects);
+
+  xrects = g_new (XRectangle, n_rects);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      xrects[i].x      = rects[i].x;
+      xrects[i].y      = rects[i].y;
+      xrects[i].width  = rects[i].width;
+      xrects[i].height = rects[i].height;
+    }
+
+  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
+
+  if (!mgr_singleton->current_region)
+    mgr_singleton->current_region = XFixesCreateRegion (xdpy, xrects, n_rects);
+  else
+    XFixesSetRegion (xdpy, mgr_singleton->current_region, xrects, n_rects);
+
+  g_free (xrects);
+  g_free (rects);
+
+  mutter_plugin_set_stage_input_region (mgr_singleton->plugin,
+                                        mgr_singleton->current_region);
+}
+
+/*
+ * Fallback for the case the stage does not get repainted after the stack
+ * changed; this runs at lower priority than the Clutter redraw, so normally
+ * the paint handler gets to the stack first.
+ */
+static gboolean
+mnb_input_manager_idle_cb (gpointer data)
+{
+  g_assert (mgr_singleton);
+
+  mgr_singleton->idle_id = 0;
+
+  if (mgr_singleton->dirty)
+    mnb_input_manager_apply_stack ();
+
+  return FALSE;
+}
+
+/*
+ * Marks the stack as dirty; it gets applied before the next stage paint, or
+ * from an idle, whichever comes first.
+ */
+static void
+mnb_input_manager_queue_apply (void)
+{
+  g_assert (mgr_singleton);
+
+  mgr_singleton->dirty = TRUE;
+
+  if (!mgr_singleton->idle_id)
+    mgr_singleton->idle_id =
+      g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                       mnb_input_manager_idle_cb, NULL, NULL);
+}
+
+/*
+ * mnb_input_manager_flush ()
+ *
+ * Applies any pending changes to the stack to the stage input shape
+ * immediately; use this when the shape must be up to date before proceeding
+ * (e.g., before establishing a grab).
+ */
+void
+mnb_input_manager_flush (void)
+{
+  g_assert (mgr_singleton);
+
+  if (mgr_singleton->dirty)
+    mnb_input_manager_apply_stack ();
 }
 
 static void
@@ -284,29 +436,18 @@ actor_allocation_cb (ClutterActor *actor, GParamSpec *pspec, gpointer data)
 {
   ClutterActorBox  box;
   MnbInputRegion  *mir = g_object_get_qdata (G_OBJECT (actor), quark_mir);
-  XserverRegion    rgn;
-  XRectangle       rect;
-  Display         *xdpy;
 
   g_assert (mgr_singleton);
 
   if (!mir)
     return;
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
-  rgn = mir->region;
-
   clutter_actor_get_allocation_box (actor, &box);
 
-  rect.x      = box.x1;
-  rect.y      = box.y1;
-  rect.width  = box.x2 - box.x1;
-  rect.height = box.y2 - box.y1;
-
-  XFixesSetRegion (xdpy, mir->region, &rect, 1);
+  mnb_input_region_set_rectangle (mir, box.x1, box.y1,
+                                  box.x2 - box.x1, box.y2 - box.y1);
 
-  mnb_input_manager_apply_stack ();
+  mnb_input_manager_queue_apply ();
 }
 
 static void
@@ -314,10 +455,8 @@ panel_allocation_cb (ClutterActor *actor, GParamSpec *pspec, gpointer data)
 {
   ClutterGeometry  geom;
   MnbInputRegion  *mir = g_object_get_qdata (G_OBJECT (actor), quark_mir);
-  XserverRegion    rgn;
-  XRectangle       rect;
-  Display         *xdpy;
   gint             screen_width, screen_height;
+  gint             y;
   MetaScreen      *screen;
   MetaWorkspace   *workspace;
 
@@ -341,20 +480,13 @@ panel_allocation_cb (ClutterActor *actor, GParamSpec *pspec, gpointer data)
       screen_height = r.y + r.height;
     }
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
-  rgn = mir->region;
-
   clutter_actor_get_geometry (actor, &geom);
 
-  rect.x      = 0;
-  rect.y      = MIN ((geom.y + geom.height), screen_height);
-  rect.width  = screen_width;
-  rect.height = screen_height - rect.y;
+  y = MIN ((geom.y + geom.height), screen_height);
 
-  XFixesSetRegion (xdpy, mir->region, &rect, 1);
+  mnb_input_region_set_rectangle (mir, 0, y, screen_width, screen_height - y);
 
-  mnb_input_manager_apply_stack ();
+  mnb_input_manager_queue_apply ();
 }
 
 static void
@@ -375,12 +507,9 @@ actor_show_cb (ClutterActor *actor, MnbInputLayer layer)
 {
   ClutterActorBox  box;
   MnbInputRegion  *mir = g_object_get_qdata (G_OBJECT (actor), quark_mir);
-  Display         *xdpy;
 
   g_assert (mgr_singleton);
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
   clutter_actor_get_allocation_box (actor, &box);
 
   if (!mir)
@@ -393,19 +522,10 @@ actor_show_cb (ClutterActor *actor, MnbInputLayer layer)
     }
   else
     {
-      XserverRegion rgn;
-      XRectangle    rect;
-
-      rgn = mir->region;
-
-      rect.x      = box.x1;
-      rect.y      = box.y1;
-      rect.width  = box.x2 - box.x1;
-      rect.height = box.y2 - box.y1;
+      mnb_input_region_set_rectangle (mir, box.x1, box.y1,
+                                      box.x2 - box.x1, box.y2 - box.y1);
 
-      XFixesSetRegion (xdpy, mir->region, &rect, 1);
-
-      mnb_input_manager_apply_stack ();
+      mnb_input_manager_queue_apply ();
     }
 }
 
@@ -414,7 +534,6 @@ panel_show_cb (ClutterActor *actor, MnbInputLayer layer)
 {
   ClutterGeometry  geom;
   MnbInputRegion  *mir  = g_object_get_qdata (G_OBJECT (actor), quark_mir);
-  Display         *xdpy;
   gint             screen_width, screen_height;
   MetaScreen      *screen;
   MetaWorkspace   *workspace;
@@ -436,8 +555,6 @@ panel_show_cb (ClutterActor *actor, MnbInputLayer layer)
       screen_height = r.y + r.height;
     }
 
-  xdpy = mutter_plugin_get_xdisplay (mgr_singleton->plugin);
-
   clutter_actor_get_geometry (actor, &geom);
 
   if (!mir)
@@ -450,19 +567,10 @@ panel_show_cb (ClutterActor *actor, MnbInputLayer layer)
     }
   else
     {
-      XserverRegion rgn;
-      XRectangle    rect;
-
-      rgn = mir->region;
-
-      rect.x      = 0;
-      rect.y      = geom.y + geom.height;
-      rect.width  = screen_width;
-      rect.height = screen_height;
-
-      XFixesSetRegion (xdpy, mir->region, &rect, 1);
+      mnb_input_region_set_rectangle (mir, 0, geom.y + geom.height,
+                                      screen_width, screen_height);
 
-      mnb_input_manager_apply_stack ();
+      mnb_input_manager_queue_apply ();
     }
 }
 
@@ -26,6 +26,7 @@
 #define MNB_INPUT_MANAGER
 
 #include <mutter-plugin.h>
+#include <gdk/gdk.h>
 
 typedef struct MnbInputRegion  MnbInputRegion;
 typedef struct MnbInputManager MnbInputManager;
@@ -55,5 +56,6 @@ void            mnb_input_manager_remove_region_without_update (MnbInputRegion
 void            mnb_input_manager_push_window (MutterWindow *mcw, MnbInputLayer layer);
 void            mnb_input_manager_push_actor  (ClutterActor *actor, MnbInputLayer layer);
 void            mnb_input_manager_push_oop_panel (MutterWindow *mcw);
+void            mnb_input_manager_flush (void);
 
 #endif
@@ -0,0 +1,366 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-paint-profiler.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "mnb-paint-profiler.h"
+
+#include <string.h>
+#include <time.h>
+
+/*
+ * Lightweight per-frame paint timing.
+ *
+ * The stage paint is bracketed by a pair of signal handlers that delimit the
+ * frame; the paint handlers of interest call mnb_paint_profiler_begin() and
+ * mnb_paint_profiler_end() around their work, and the time is accumulated
+ * against the current frame (an actor might get painted more than once per
+ * frame, e.g., via a clone).
+ *
+ * The last MNB_PAINT_PROFILER_FRAMES frames are kept in a ring buffer; in
+ * addition we keep a histogram for each stage (and the frame as whole) since
+ * the last reset, with buckets doubling in size from 128us upwards.
+ *
+ * We also count the frames rendered for each panel show and hide, from the
+ * start of the transition up to, and including, the first frame painted once
+ * the transition completed (i.e., the frame that shows the final placement).
+ *
+ * The data is exposed via the GetPaintProfile method of the Toolbar D-Bus
+ * interface, and can be dumped with the meego-paint-profile tool.
+ */
+
+#define MNB_PAINT_PROFILER_FRAMES  256
+#define MNB_PAINT_PROFILER_BUCKETS 12
+#define MNB_PAINT_PROFILER_BUCKET0 128 /* us */
+#define MNB_PAINT_PROFILER_PENDING 4
+
+typedef struct
+{
+  guint32 total;
+  guint32 stages[MNB_PAINT_STAGE_LAST];
+} MnbPaintFrame;
+
+typedef struct
+{
+  MnbPaintToggle toggle;
+  guint          start;
+} MnbPaintPendingToggle;
+
+typedef struct
+{
+  guint count;
+  guint frames;
+  guint max;
+} MnbPaintToggleStats;
+
+typedef struct
+{
+  MnbPaintFrame frames[MNB_PAINT_PROFILER_FRAMES];
+  guint         n_frames;     /* total frames since last reset */
+  guint         current;      /* index of the current frame    */
+  gint64        frame_start;  /* 0 when outside of a frame     */
+
+  guint         stage_hist[MNB_PAINT_STAGE_LAST][MNB_PAINT_PROFILER_BUCKETS];
+  guint         frame_hist[MNB_PAINT_PROFILER_BUCKETS];
+
+  /* Toggles waiting for the next frame to complete */
+  MnbPaintPendingToggle pending[MNB_PAINT_PROFILER_PENDING];
+  gint                  n_pending;
+
+  MnbPaintToggleStats   toggles[MNB_PAINT_TOGGLE_LAST];
+} MnbPaintProfiler;
+
+static MnbPaintProfiler *profiler = NULL;
+
+static const gchar *stage_names[MNB_PAINT_STAGE_LAST] =
+{
+  "background",
+  "toolbar",
+  "notifications",
+  "alttab",
+  "zones",
+};
+
+static const gchar *toggle_names[MNB_PAINT_TOGGLE_LAST] =
+{
+  "animated",
+  "instant",
+};
+
+static inline gint64
+mnb_paint_profiler_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000) + ts.tv_nsec / 1000;
+}
+
+static inline guint
+mnb_paint_profiler_bucket (guint32 us)
+{
+  guint  bucket = 0;
+  guint  limit  = MNB_PAINT_PROFILER_BUCKET0;
+
+  while (us >= limit && bucket < MNB_PAINT_PROFILER_BUCKETS - 1)
+    {
+      limit <<= 1;
+      bucket++;
+    }
+
+  return bucket;
+}
+
+static void
+mnb_paint_profiler_toggle_record (MnbPaintToggle toggle, guint start)
+{
+  MnbPaintToggleStats *stats = &profiler->toggles[toggle];
+  guint                frames;
+
+  /* The profile was reset in the meantime */
+  if (start > profiler->n_frames)
+    return;
+
+  frames = profiler->n_frames - start;
+
+  stats->count++;
+  stats->frames += frames;
+
+  if (frames > stats->max)
+    stats->max = frames;
+}
+
+static void
+mnb_paint_profiler_frame_begin_cb (ClutterActor *stage, gpointer data)
+{
+  MnbPaintFrame *frame;
+
+  profiler->current = profiler->n_frames % MNB_PAINT_PROFILER_FRAMES;
+
+  frame = &profiler->frames[profiler->current];
+  memset (frame, 0, sizeof (MnbPaintFrame));
+
+  profiler->frame_start = mnb_paint_profiler_now ();
+}
+
+static void
+mnb_paint_profiler_frame_end_cb (ClutterActor *stage, gpointer data)
+{
+  MnbPaintFrame *frame = &profiler->frames[profiler->current];
+  gint           i;
+
+  if (!profiler->frame_start)
+    return;
+
+  frame->total = mnb_paint_profiler_now () - profiler->frame_start;
+  profiler->frame_start = 0;
+
+  profiler->frame_hist[mnb_paint_profiler_bucket (frame->total)]++;
+
+  for (i = 0; i < MNB_PAINT_STAGE_LAST; i++)
+    if (frame->stages[i])
+      profiler->stage_hist[i][mnb_paint_profiler_bucket (frame->stages[i])]++;
+
+  profiler->n_frames++;
+
+  for (i = 0; i < profiler->n_pending; i++)
+    mnb_paint_profiler_toggle_record (profiler->pending[i].toggle,
+                                      profiler->pending[i].start);
+
+  profiler->n_pending = 0;
+}
+
+/*
+ * Hooks the profiler into the paint cycle of the given stage.
+ */
+void
+mnb_paint_profiler_init (ClutterActor *stage)
+{
+  g_return_if_fail (!profiler);
+
+  profiler = g_new0 (MnbPaintProfiler, 1);
+
+  g_signal_connect (stage, "paint",
+                    G_CALLBACK (mnb_paint_profiler_frame_begin_cb), NULL);
+  g_signal_connect_after (stage, "paint",
+                          G_CALLBACK (mnb_paint_profiler_frame_end_cb), NULL);
+}
+
+/*
+ * Returns the time stamp to be passed to mnb_paint_profiler_end().
+ */
+gint64
+mnb_paint_profiler_begin (void)
+{
+  if (!profiler || !profiler->frame_start)
+    return 0;
+
+  return mnb_paint_profiler_now ();
+}
+
+void
+mnb_paint_profiler_end (MnbPaintStage stage, gint64 start)
+{
+  if (!start || !profiler || !profiler->frame_start)
+    return;
+
+  profiler->frames[profiler->current].stages[stage] +=
+    mnb_paint_profiler_now () - start;
+}
+
+static void
+mnb_paint_profiler_dump_row (GString     *str,
+                             const gchar *name,
+                             guint        n_frames,
+                             gsize        offset,
+                             guint       *hist)
+{
+  guint   i;
+  guint32 last = 0, max = 0;
+  guint64 sum  = 0;
+
+  for (i = 0; i < n_frames; i++)
+    {
+      MnbPaintFrame *frame = &profiler->frames[i];
+      guint32        t     = G_STRUCT_MEMBER (guint32, frame, offset);
+
+      sum += t;
+
+      if (t > max)
+        max = t;
+    }
+
+  if (profiler->n_frames)
+    {
+      guint          l     = (profiler->n_frames - 1) % MNB_PAINT_PROFILER_FRAMES;
+      MnbPaintFrame *frame = &profiler->frames[l];
+
+      last = G_STRUCT_MEMBER (guint32, frame, offset);
+    }
+
+  g_string_append_printf (str, "%-14s %8u %8u %8u ",
+                          name, last,
+                          n_frames ? (guint) (sum / n_frames) : 0,
+                          max);
+
+  for (i = 0; i < MNB_PAINT_PROFILER_BUCKETS; i++)
+    g_string_append_printf (str, " %u", hist[i]);
+
+  g_string_append_c (str, '\n');
+}
+
+/*
+ * Marks the start of a panel show or hide; the return value is to be passed
+ * to mnb_paint_profiler_toggle_end() when the transition completes.
+ */
+guint
+mnb_paint_profiler_toggle_begin (void)
+{
+  if (!profiler)
+    return 0;
+
+  return profiler->n_frames;
+}
+
+void
+mnb_paint_profiler_toggle_end (MnbPaintToggle toggle, guint start)
+{
+  if (!profiler)
+    return;
+
+  /*
+   * The final placement only becomes visible with the next frame, so we
+   * defer the accounting until that is painted.
+   */
+  if (profiler->n_pending == MNB_PAINT_PROFILER_PENDING)
+    {
+      mnb_paint_profiler_toggle_record (toggle, start);
+      return;
+    }
+
+  profiler->pending[profiler->n_pending].toggle = toggle;
+  profiler->pending[profiler->n_pending].start  = start;
+  profiler->n_pending++;
+}
+
+/*
+ * Returns a textual dump of the profile; the first part of each row is the
+ * last, average and maximum time (in microseconds) over the frames in the ring
+ * buffer, followed by the histogram since the last reset. The toggle rows give
+ * the number of panel shows and hides since the last reset, and the average
+ * and maximum number of frames each took. The returned string should be freed
+ * with g_free().
+ */
+gchar *
+mnb_paint_profiler_dump (gboolean reset)
+{
+  GString *str;
+  guint    n_frames;
+  guint    i, limit;
+
+  if (!profiler)
+    return g_strdup ("");
+
+  str = g_string_new (NULL);
+
+  n_frames = MIN (profiler->n_frames, MNB_PAINT_PROFILER_FRAMES);
+
+  g_string_append_printf (str, "frames %u\n", profiler->n_frames);
+  g_string_append_printf (str, "window %u\n", n_frames);
+
+  g_string_append (str, "buckets");
+  for (i = 0, limit = MNB_PAINT_PROFILER_BUCKET0;
+       i < MNB_PAINT_PROFILER_BUCKETS - 1;
+       i++, limit <<= 1)
+    g_string_append_printf (str, " <%u", limit);
+  g_string_append_printf (str, " >=%u\n", limit >> 1);
+
+  mnb_paint_profiler_dump_row (str, "frame", n_frames,
+                               G_STRUCT_OFFSET (MnbPaintFrame, total),
+                               profiler->frame_hist);
+
+  for (i = 0; i < MNB_PAINT_STAGE_LAST; i++)
+    mnb_paint_profiler_dump_row (str, stage_names[i], n_frames,
+                                 G_STRUCT_OFFSET (MnbPaintFrame, stages) +
+                                 i * sizeof (guint32),
+                                 profiler->stage_hist[i]);
+
+  for (i = 0; i < MNB_PAINT_TOGGLE_LAST; i++)
+    {
+      MnbPaintToggleStats *stats = &profiler->toggles[i];
+
+      g_string_append_printf (str, "toggle %-8s %6u %8.1f %8u\n",
+                              toggle_names[i], stats->count,
+                              stats->count ?
+                              (gdouble) stats->frames / stats->count : 0.0,
+                              stats->max);
+    }
+
+  if (reset)
+    {
+      gint64 frame_start = profiler->frame_start;
+
+      memset (profiler, 0, sizeof (MnbPaintProfiler));
+      profiler->frame_start = frame_start;
+    }
+
+  return g_string_free (str, FALSE);
+}
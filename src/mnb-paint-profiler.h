@@ -0,0 +1,63 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-paint-profiler.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef MNB_PAINT_PROFILER_H
+#define MNB_PAINT_PROFILER_H
+
+#include <clutter/clutter.h>
+
+/*
+ * The parts of the frame we time separately.
+ */
+typedef enum
+{
+  MNB_PAINT_STAGE_BACKGROUND = 0,
+  MNB_PAINT_STAGE_TOOLBAR,
+  MNB_PAINT_STAGE_NOTIFICATIONS,
+  MNB_PAINT_STAGE_ALTTAB,
+  MNB_PAINT_STAGE_ZONES,
+
+  /* Must be last */
+  MNB_PAINT_STAGE_LAST
+} MnbPaintStage;
+
+/*
+ * The kinds of panel show/hide we count frames for.
+ */
+typedef enum
+{
+  MNB_PAINT_TOGGLE_ANIMATED = 0,
+  MNB_PAINT_TOGGLE_INSTANT,
+
+  /* Must be last */
+  MNB_PAINT_TOGGLE_LAST
+} MnbPaintToggle;
+
+void    mnb_paint_profiler_init  (ClutterActor *stage);
+gint64  mnb_paint_profiler_begin (void);
+void    mnb_paint_profiler_end   (MnbPaintStage stage, gint64 start);
+gchar  *mnb_paint_profiler_dump  (gboolean reset);
+
+guint   mnb_paint_profiler_toggle_begin (void);
+void    mnb_paint_profiler_toggle_end   (MnbPaintToggle toggle, guint start);
+
+#endif
@@ -24,10 +24,13 @@
 
 #include "mnb-panel-oop.h"
 #include "mnb-toolbar.h"
+#include "mnb-paint-profiler.h"
 
 #include "marshal.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <dbus/dbus-glib.h>
 #include <dbus/dbus-glib-bindings.h>
 #include <dbus/dbus-glib-lowlevel.h>
@@ -64,7 +67,6 @@ G_DEFINE_TYPE_WITH_CODE (MnbPanelOop,
 static void     mnb_panel_oop_constructed    (GObject  *self);
 static gboolean mnb_panel_oop_setup_proxy    (MnbPanelOop *panel);
 static void     mnb_panel_oop_init_owner     (MnbPanelOop *panel);
-static void     mnb_panel_oop_dbus_proxy_weak_notify_cb (gpointer, GObject *);
 
 static const gchar * mnb_panel_oop_get_name (MnbPanel *panel);
 static const gchar * mnb_panel_oop_get_tooltip (MnbPanel *panel);
@@ -101,7 +103,23 @@ struct _MnbPanelOopPrivate
 {
   DBusGConnection *dbus_conn;
   DBusGProxy      *proxy;
-  DBusGProxy      *proxy_for_owner;
+  DBusGProxy      *bus_proxy;
+  DBusGProxyCall  *init_call;
+  DBusGProxyCall  *owner_call;
+  DBusGProxyCall  *ping_call;
+  DBusGProxyCall  *geometry_call;
+  GTimer          *ping_timer;
+
+  MnbPanelOopHealth health;
+
+  guint            show_trace_id; /* see mnb_panel_oop_trace() */
+  guint            hide_trace_id;
+  guint            sent_trace_id; /* last id passed to the panel */
+
+  guint            show_frame_start; /* see mnb_paint_profiler_toggle_begin() */
+  guint            hide_frame_start;
+
+  gchar           *dbus_owner; /* unique name of the panel process */
 
   gchar           *dbus_name;
   gchar           *dbus_path;
@@ -117,6 +135,8 @@ struct _MnbPanelOopPrivate
   gint             y;
   guint            width;
   guint            height;
+  guint            geometry_width;  /* size last passed to SetGeometry */
+  guint            geometry_height;
 
   MutterWindow    *mcw;
 
@@ -125,6 +145,7 @@ struct _MnbPanelOopPrivate
   gboolean         dead             : 1; /* Set when the remote  */
   gboolean         ready            : 1;
   gboolean         hide_in_progress : 1;
+  gboolean         no_set_geometry  : 1; /* panel predates SetGeometry */
 
   /*
    * The show/hide machinery
@@ -338,6 +359,24 @@ mnb_panel_oop_dispose (GObject *self)
 
   if (proxy)
     {
+      if (priv->init_call)
+        {
+          dbus_g_proxy_cancel_call (proxy, priv->init_call);
+          priv->init_call = NULL;
+        }
+
+      if (priv->ping_call)
+        {
+          dbus_g_proxy_cancel_call (proxy, priv->ping_call);
+          priv->ping_call = NULL;
+        }
+
+      if (priv->geometry_call)
+        {
+          dbus_g_proxy_cancel_call (proxy, priv->geometry_call);
+          priv->geometry_call = NULL;
+        }
+
       dbus_g_proxy_disconnect_signal (proxy, "RequestFocus",
                                    G_CALLBACK (mnb_panel_oop_request_focus_cb),
                                    self);
@@ -361,9 +400,17 @@ mnb_panel_oop_dispose (GObject *self)
       priv->proxy = NULL;
     }
 
-  if (priv->proxy_for_owner)
-    g_object_weak_unref (G_OBJECT (priv->proxy_for_owner),
-                         mnb_panel_oop_dbus_proxy_weak_notify_cb, self);
+  if (priv->bus_proxy)
+    {
+      if (priv->owner_call)
+        {
+          dbus_g_proxy_cancel_call (priv->bus_proxy, priv->owner_call);
+          priv->owner_call = NULL;
+        }
+
+      g_object_unref (priv->bus_proxy);
+      priv->bus_proxy = NULL;
+    }
 
   if (priv->dbus_conn)
     {
@@ -388,6 +435,10 @@ mnb_panel_oop_finalize (GObject *object)
 
   g_free (priv->dbus_name);
   g_free (priv->dbus_path);
+  g_free (priv->dbus_owner);
+
+  if (priv->ping_timer)
+    g_timer_destroy (priv->ping_timer);
 
   g_free (priv->name);
   g_free (priv->tooltip);
@@ -518,6 +569,84 @@ mnb_panel_oop_init (MnbPanelOop *self)
   priv = self->priv = MNB_PANEL_OOP_GET_PRIVATE (self);
 }
 
+/*
+ * Show/hide tracing.
+ *
+ * When MEEGO_PANEL_TRACE_DIR is set, each show and hide request gets a trace
+ * id, which is passed to the panel with all the related D-Bus calls; both the
+ * compositor (here) and the panel (in MplPanelClient) then log the stages of
+ * the request with monotonic timestamps, and meego-panel-trace merges the logs
+ * into a per-panel latency breakdown.
+ */
+static FILE *
+mnb_panel_oop_trace_file (void)
+{
+  static FILE     *trace_file = NULL;
+  static gboolean  initialized = FALSE;
+
+  if (!initialized)
+    {
+      const gchar *dir = g_getenv ("MEEGO_PANEL_TRACE_DIR");
+
+      initialized = TRUE;
+
+      if (dir && *dir)
+        {
+          gchar *path = g_build_filename (dir, "compositor.trace", NULL);
+
+          if (!(trace_file = fopen (path, "a")))
+            g_warning ("Could not open trace file %s", path);
+
+          g_free (path);
+        }
+    }
+
+  return trace_file;
+}
+
+static guint
+mnb_panel_oop_new_trace_id (void)
+{
+  static guint trace_id = 0;
+
+  if (!mnb_panel_oop_trace_file ())
+    return 0;
+
+  /*
+   * Start from a random base, so that ids from different compositor runs
+   * appended to the same log do not clash.
+   */
+  if (!trace_id)
+    trace_id = g_random_int_range (1, G_MAXINT32);
+
+  return ++trace_id;
+}
+
+static void
+mnb_panel_oop_trace (MnbPanelOop *panel, guint trace_id, const gchar *event)
+{
+  MnbPanelOopPrivate *priv = panel->priv;
+  FILE               *file;
+  struct timespec     ts;
+  const gchar        *name;
+
+  if (!trace_id || !(file = mnb_panel_oop_trace_file ()))
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  name = priv->dbus_name;
+
+  if (g_str_has_prefix (name, MPL_PANEL_DBUS_NAME_PREFIX))
+    name += strlen (MPL_PANEL_DBUS_NAME_PREFIX);
+
+  fprintf (file, "%" G_GINT64_FORMAT " %s %u %s\n",
+           (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000) +
+           ts.tv_nsec / 1000,
+           name, trace_id, event);
+  fflush (file);
+}
+
 /*
  * It is not possible to pass a NULL for the reply function into the
  * autogenerated bindings, as they do not check :/
@@ -529,6 +658,26 @@ mnb_panel_oop_dbus_dumb_reply_cb (DBusGProxy *proxy,
 {
 }
 
+/*
+ * Tells the panel the trace id of the show or hide calls that follow; this is
+ * only done when tracing, so panels built against an older libmeego-panel are
+ * not affected otherwise.
+ */
+static void
+mnb_panel_oop_send_trace_id (MnbPanelOop *panel, guint trace_id)
+{
+  MnbPanelOopPrivate *priv = panel->priv;
+
+  if (!trace_id || trace_id == priv->sent_trace_id)
+    return;
+
+  priv->sent_trace_id = trace_id;
+
+  com_meego_UX_Shell_Panel_set_trace_id_async (priv->proxy, trace_id,
+                                               mnb_panel_oop_dbus_dumb_reply_cb,
+                                               NULL);
+}
+
 /*
  * Signal closures for show/hide related signals; we translate these into the
  * appropriate dbus method calls.
@@ -538,6 +687,10 @@ mnb_panel_oop_show_begin (MnbPanel *self)
 {
   MnbPanelOopPrivate *priv = MNB_PANEL_OOP (self)->priv;
 
+  mnb_panel_oop_trace ((MnbPanelOop*)self, priv->show_trace_id, "show-begin");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)self, priv->show_trace_id);
+
   com_meego_UX_Shell_Panel_show_begin_async (priv->proxy,
                                              mnb_panel_oop_dbus_dumb_reply_cb,
                                              NULL);
@@ -550,9 +703,15 @@ mnb_panel_oop_show_completed (MnbPanel *self)
 
   mnb_panel_oop_focus (MNB_PANEL_OOP (self));
 
+  mnb_panel_oop_trace ((MnbPanelOop*)self, priv->show_trace_id, "show-end");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)self, priv->show_trace_id);
+
   com_meego_UX_Shell_Panel_show_end_async (priv->proxy,
                                            mnb_panel_oop_dbus_dumb_reply_cb,
                                            NULL);
+
+  priv->show_trace_id = 0;
 }
 
 static void
@@ -568,6 +727,10 @@ mnb_panel_oop_hide_begin (MnbPanel *self)
       return;
     }
 
+  mnb_panel_oop_trace ((MnbPanelOop*)self, priv->hide_trace_id, "hide-begin");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)self, priv->hide_trace_id);
+
   com_meego_UX_Shell_Panel_hide_begin_async (priv->proxy,
                                              mnb_panel_oop_dbus_dumb_reply_cb,
                                              NULL);
@@ -586,9 +749,15 @@ mnb_panel_oop_hide_completed (MnbPanel *self)
       return;
     }
 
+  mnb_panel_oop_trace ((MnbPanelOop*)self, priv->hide_trace_id, "hide-end");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)self, priv->hide_trace_id);
+
   com_meego_UX_Shell_Panel_hide_end_async (priv->proxy,
                                            mnb_panel_oop_dbus_dumb_reply_cb,
                                            NULL);
+
+  priv->hide_trace_id = 0;
 }
 
 static DBusGConnection *
@@ -610,12 +779,12 @@ mnb_panel_oop_connect_to_dbus ()
 }
 
 static void
-mnb_panel_oop_dbus_proxy_weak_notify_cb (gpointer data, GObject *object)
+mnb_panel_oop_remote_process_died (MnbPanelOop *panel)
 {
-  MnbPanelOop        *panel = MNB_PANEL_OOP (data);
-  MnbPanelOopPrivate *priv  = panel->priv;
+  MnbPanelOopPrivate *priv = panel->priv;
 
-  priv->proxy_for_owner = NULL;
+  g_free (priv->dbus_owner);
+  priv->dbus_owner = NULL;
 
   g_object_ref (panel);
   priv->ready = FALSE;
@@ -624,6 +793,54 @@ mnb_panel_oop_dbus_proxy_weak_notify_cb (gpointer data, GObject *object)
   g_object_unref (panel);
 }
 
+/*
+ * Called by the Toolbar from its NameOwnerChanged handler when the owner of
+ * our well-known name changes (the Toolbar watches all the panel names, so we
+ * do not need a signal handler of our own for each panel). If the process we
+ * were initialized by lets go of the name, it is gone.
+ */
+void
+mnb_panel_oop_name_owner_changed (MnbPanelOop *panel,
+                                  const gchar *old_owner,
+                                  const gchar *new_owner)
+{
+  MnbPanelOopPrivate *priv = panel->priv;
+
+  if (!priv->dbus_owner || !old_owner || strcmp (old_owner, priv->dbus_owner))
+    return;
+
+  mnb_panel_oop_remote_process_died (panel);
+}
+
+static void
+mnb_panel_oop_get_name_owner_reply_cb (DBusGProxy *proxy,
+                                       gchar      *owner,
+                                       GError     *error,
+                                       gpointer    data)
+{
+  MnbPanelOop        *panel = MNB_PANEL_OOP (data);
+  MnbPanelOopPrivate *priv  = panel->priv;
+
+  priv->owner_call = NULL;
+
+  if (error)
+    {
+      /*
+       * The panel has gone away between replying to InitPanel and us asking
+       * for the owner.
+       */
+      g_warning ("Could not find owner of %s: %s",
+                 priv->dbus_name, error->message);
+      g_error_free (error);
+
+      mnb_panel_oop_remote_process_died (panel);
+      return;
+    }
+
+  g_free (priv->dbus_owner);
+  priv->dbus_owner = owner;
+}
+
 static void
 mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
                                        gchar      *name,
@@ -638,6 +855,8 @@ mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
 {
   MnbPanelOopPrivate *priv = MNB_PANEL_OOP (panel)->priv;
 
+  priv->init_call = NULL;
+
   if (error)
     {
       g_warning ("Could not initialize Panel %s: %s",
@@ -646,23 +865,21 @@ mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
       return;
     }
 
-  priv->proxy_for_owner =
-    dbus_g_proxy_new_for_name_owner (priv->dbus_conn,
-                                     priv->dbus_name,
-                                     priv->dbus_path,
-                                     MPL_PANEL_DBUS_INTERFACE,
-                                     &error);
-
-  if (error)
-    {
-      g_warning ("Could not create owner-specif proxy for %s: %s",
-                 priv->dbus_name, error->message);
-      g_clear_error (&error);
-    }
-  else
+  /*
+   * Find out the unique name of the process that answered, so we can tell
+   * when it dies; this used to be a blocking call, so ask asynchronously and
+   * carry on with the initialization in the meantime.
+   */
+  if (priv->bus_proxy)
     {
-      g_object_weak_ref (G_OBJECT (priv->proxy_for_owner),
-                         mnb_panel_oop_dbus_proxy_weak_notify_cb, panel);
+      if (priv->owner_call)
+        dbus_g_proxy_cancel_call (priv->bus_proxy, priv->owner_call);
+
+      priv->owner_call =
+        org_freedesktop_DBus_get_name_owner_async (priv->bus_proxy,
+                                   priv->dbus_name,
+                                   mnb_panel_oop_get_name_owner_reply_cb,
+                                   panel);
     }
 
   /*
@@ -685,6 +902,7 @@ mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
   priv->xid = xid;
 
   g_free (priv->child_class);
+  priv->child_class = NULL;
 
   /*
    * Retrieve the WM_CLASS property for the child window (we have to do it the
@@ -692,6 +910,9 @@ mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
    * not the application).
    *
    * (We use the wm-class to identify sub-windows.)
+   *
+   * This is done now rather than when the panel window maps, so that
+   * sub-windows mapped before the panel window are recognized.
    */
   if (xid)
     {
@@ -737,6 +958,11 @@ mnb_panel_oop_init_panel_oop_reply_cb (DBusGProxy *proxy,
   priv->dead = FALSE;
   priv->initialized = TRUE;
 
+  /* A restarted panel might be built against a newer libmeego-panel. */
+  priv->no_set_geometry = FALSE;
+  priv->geometry_width  = 0;
+  priv->geometry_height = 0;
+
   if (priv->ready)
     g_signal_emit (panel, signals[READY], 0);
 
@@ -766,7 +992,11 @@ mnb_panel_oop_init_owner (MnbPanelOop *panel)
    * Now call the remote init_panel_oop() method to obtain the panel name,
    * tooltip and xid.
    */
-  com_meego_UX_Shell_Panel_init_panel_async (priv->proxy,
+  if (priv->init_call)
+    dbus_g_proxy_cancel_call (priv->proxy, priv->init_call);
+
+  priv->init_call =
+    com_meego_UX_Shell_Panel_init_panel_async (priv->proxy,
                                           priv->x,
                                           priv->y,
                                           priv->width, priv->height,
@@ -896,6 +1126,15 @@ mnb_panel_oop_setup_proxy (MnbPanelOop *panel)
                                G_CALLBACK (mnb_panel_oop_ready_cb),
                                panel, NULL);
 
+  /*
+   * The bus proxy is used to look up the owner of the panel process; see
+   * mnb_panel_oop_name_owner_changed().
+   */
+  priv->bus_proxy = dbus_g_proxy_new_for_name (priv->dbus_conn,
+                                               DBUS_SERVICE_DBUS,
+                                               DBUS_PATH_DBUS,
+                                               DBUS_INTERFACE_DBUS);
+
   mnb_panel_oop_init_owner (panel);
 
   return TRUE;
@@ -1045,6 +1284,14 @@ mnb_panel_oop_show_mutter_window (MnbPanelOop *panel, MutterWindow *mcw)
   priv->mcw = mcw;
   priv->mapped = TRUE;
 
+  /*
+   * The panel might have mapped itself, without us asking it to.
+   */
+  if (!priv->show_trace_id)
+    priv->show_trace_id = mnb_panel_oop_new_trace_id ();
+
+  mnb_panel_oop_trace (panel, priv->show_trace_id, "window-mapped");
+
   g_signal_connect (mcw, "destroy",
                     G_CALLBACK (mnb_panel_oop_mutter_window_destroy_cb),
                     panel);
@@ -1245,11 +1492,19 @@ mnb_toolbar_ping_panel_oop (DBusGConnection *dbus_conn, const gchar *dbus_name)
   g_object_unref (proxy);
 }
 
+/*
+ * The anim argument is NULL when the panel was shown in the instant mode.
+ */
 static void
 mnb_panel_oop_show_completed_cb (ClutterAnimation *anim, MnbPanelOop *panel)
 {
   MnbPanelOopPrivate *priv = panel->priv;
 
+  mnb_paint_profiler_toggle_end (anim ?
+                                 MNB_PAINT_TOGGLE_ANIMATED :
+                                 MNB_PAINT_TOGGLE_INSTANT,
+                                 priv->show_frame_start);
+
   priv->in_show_animation = FALSE;
   priv->dont_hide_toolbar = FALSE;
   priv->show_anim = NULL;
@@ -1336,6 +1591,8 @@ mnb_panel_oop_show_animate (MnbPanelOop *panel)
       return;
     }
 
+  priv->show_frame_start = mnb_paint_profiler_toggle_begin ();
+
   g_signal_emit_by_name (panel, "show-begin");
 
   /*
@@ -1343,7 +1600,19 @@ mnb_panel_oop_show_animate (MnbPanelOop *panel)
    */
   clutter_actor_show (mcw);
 
-  if (priv->delayed_show)
+  if (meego_netbook_use_instant_mode (plugin))
+    {
+      /*
+       * The mcw is already in its final position, so all that remains is to
+       * make sure it is fully opaque.
+       */
+      priv->in_show_animation = TRUE;
+
+      clutter_actor_set_opacity (mcw, 0xff);
+
+      mnb_panel_oop_show_completed_cb (NULL, panel);
+    }
+  else if (priv->delayed_show)
     {
       priv->in_show_animation = TRUE;
 
@@ -1402,17 +1671,31 @@ mnb_panel_oop_show (MnbPanel *panel)
       priv->in_hide_animation = FALSE;
     }
 
+  priv->show_trace_id = mnb_panel_oop_new_trace_id ();
+  mnb_panel_oop_trace ((MnbPanelOop*)panel, priv->show_trace_id,
+                       "show-request");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)panel, priv->show_trace_id);
+
   com_meego_UX_Shell_Panel_show_async (priv->proxy,
                                        mnb_panel_oop_dbus_dumb_reply_cb,
                                        NULL);
 }
 
+/*
+ * The anim argument is NULL when the panel was hidden in the instant mode.
+ */
 static void
 mnb_panel_oop_hide_completed_cb (ClutterAnimation *anim, MnbPanelOop *panel)
 {
   MnbPanelOopPrivate *priv = panel->priv;
   MutterPlugin       *plugin = meego_netbook_get_plugin_singleton ();
 
+  mnb_paint_profiler_toggle_end (anim ?
+                                 MNB_PAINT_TOGGLE_ANIMATED :
+                                 MNB_PAINT_TOGGLE_INSTANT,
+                                 priv->hide_frame_start);
+
   priv->hide_anim = NULL;
   priv->hide_completed_id = 0;
   priv->mapped = FALSE;
@@ -1441,6 +1724,7 @@ void
 mnb_panel_oop_hide_animate (MnbPanelOop *panel, MutterWindow *mcw)
 {
   MnbPanelOopPrivate  *priv = panel->priv;
+  MutterPlugin        *plugin = meego_netbook_get_plugin_singleton ();
   ClutterAnimation    *animation;
   ClutterActor        *actor = CLUTTER_ACTOR (mcw);
 
@@ -1466,6 +1750,16 @@ mnb_panel_oop_hide_animate (MnbPanelOop *panel, MutterWindow *mcw)
         }
     }
 
+  /*
+   * The panel might have hidden itself, without us asking it to.
+   */
+  if (!priv->hide_trace_id)
+    priv->hide_trace_id = mnb_panel_oop_new_trace_id ();
+
+  mnb_panel_oop_trace (panel, priv->hide_trace_id, "window-unmapped");
+
+  priv->hide_frame_start = mnb_paint_profiler_toggle_begin ();
+
   g_signal_emit_by_name (panel, "hide-begin");
 
   /* de-activate the button */
@@ -1478,6 +1772,14 @@ mnb_panel_oop_hide_animate (MnbPanelOop *panel, MutterWindow *mcw)
         mx_button_set_toggled (priv->button, FALSE);
     }
 
+  if (meego_netbook_use_instant_mode (plugin))
+    {
+      clutter_actor_set_y (actor, -clutter_actor_get_height (actor));
+
+      mnb_panel_oop_hide_completed_cb (NULL, panel);
+      return;
+    }
+
   animation = clutter_actor_animate (actor, CLUTTER_EASE_IN_SINE,
                                      SLIDE_DURATION,
                                      "y", -clutter_actor_get_height (actor),
@@ -1512,6 +1814,12 @@ mnb_panel_oop_hide (MnbPanel *panel)
 
   priv->modal  = FALSE;
 
+  priv->hide_trace_id = mnb_panel_oop_new_trace_id ();
+  mnb_panel_oop_trace ((MnbPanelOop*)panel, priv->hide_trace_id,
+                       "hide-request");
+
+  mnb_panel_oop_send_trace_id ((MnbPanelOop*)panel, priv->hide_trace_id);
+
   com_meego_UX_Shell_Panel_hide_async (priv->proxy,
                                        mnb_panel_oop_dbus_dumb_reply_cb,
                                        NULL);
@@ -1622,11 +1930,106 @@ mnb_panel_oop_set_position (MnbPanel *panel, gint x, gint y)
   if (!x_change && !y_change)
     return;
 
+  priv->x = x;
+  priv->y = y;
+
   com_meego_UX_Shell_Panel_set_position_async (priv->proxy, x, y,
                                             mnb_panel_oop_dbus_dumb_reply_cb,
                                             NULL);
 }
 
+static void
+mnb_panel_oop_set_geometry_reply_cb (DBusGProxy *proxy,
+                                     GError     *error,
+                                     gpointer    data)
+{
+  MnbPanelOop        *panel = MNB_PANEL_OOP (data);
+  MnbPanelOopPrivate *priv  = panel->priv;
+
+  priv->geometry_call = NULL;
+
+  if (!error)
+    return;
+
+  /*
+   * Panels built against a libmeego-panel older than SetGeometry do not
+   * implement it; fall back to SetSize and SetPosition, and do so directly
+   * from now on.
+   */
+  if (dbus_g_error_has_name (error,
+                             "org.freedesktop.DBus.Error.UnknownMethod"))
+    {
+      priv->no_set_geometry = TRUE;
+
+      com_meego_UX_Shell_Panel_set_size_async (priv->proxy,
+                                            priv->geometry_width,
+                                            priv->geometry_height,
+                                            mnb_panel_oop_dbus_dumb_reply_cb,
+                                            NULL);
+      com_meego_UX_Shell_Panel_set_position_async (priv->proxy,
+                                            priv->x, priv->y,
+                                            mnb_panel_oop_dbus_dumb_reply_cb,
+                                            NULL);
+    }
+
+  g_error_free (error);
+}
+
+/*
+ * Moves and resizes the panel with a single dbus call (and so a single
+ * configure of the panel window).
+ */
+static void
+mnb_panel_oop_set_geometry (MnbPanel *panel,
+                            gint      x,
+                            gint      y,
+                            guint     width,
+                            guint     height)
+{
+  MnbPanelOopPrivate *priv = MNB_PANEL_OOP (panel)->priv;
+  gboolean            change = FALSE;
+
+  if (priv->no_set_geometry)
+    {
+      mnb_panel_oop_set_size (panel, width, height);
+      mnb_panel_oop_set_position (panel, x, y);
+      return;
+    }
+
+  /*
+   * Neither the window geometry nor priv->width and priv->height are a
+   * reliable indication here: the window gets moved around by the show/hide
+   * animations, and the panel reports back its real height, which is often
+   * less than the maximum height we pass in; compare against the geometry we
+   * last asked for.
+   */
+  if (priv->x != x || priv->y != y ||
+      priv->geometry_width != width || priv->geometry_height != height)
+    change = TRUE;
+
+  if (!change)
+    return;
+
+  priv->x               = x;
+  priv->y               = y;
+  priv->width           = width;
+  priv->height          = height;
+  priv->geometry_width  = width;
+  priv->geometry_height = height;
+
+  /*
+   * Only the latest reply matters; a superseded call still reaches the panel.
+   */
+  if (priv->geometry_call)
+    dbus_g_proxy_cancel_call (priv->proxy, priv->geometry_call);
+
+  priv->geometry_call =
+    com_meego_UX_Shell_Panel_set_geometry_async (priv->proxy, x, y,
+                                          width, height,
+                                          mnb_panel_oop_set_geometry_reply_cb,
+                                          panel);
+}
+
 static void
 mnb_panel_oop_get_position (MnbPanel *panel, gint *x, gint *y)
 {
@@ -1662,6 +2065,7 @@ mnb_panel_iface_init (MnbPanelIface *iface)
   iface->get_size         = mnb_panel_oop_get_size;
   iface->set_position     = mnb_panel_oop_set_position;
   iface->get_position     = mnb_panel_oop_get_position;
+  iface->set_geometry     = mnb_panel_oop_set_geometry;
 
   iface->set_button       = mnb_panel_oop_set_button;
 
@@ -1679,6 +2083,76 @@ mnb_panel_oop_unload (MnbPanelOop *panel)
                                          NULL);
 }
 
+static void
+mnb_panel_oop_ping_reply_cb (DBusGProxy *proxy, GError *error, gpointer data)
+{
+  MnbPanelOopPrivate *priv   = MNB_PANEL_OOP (data)->priv;
+  MnbPanelOopHealth  *health = &priv->health;
+  gdouble             latency;
+
+  priv->ping_call = NULL;
+
+  if (error)
+    {
+      /*
+       * If the process died, we will find out via the owner tracking; just
+       * do not count this as a reply.
+       */
+      g_error_free (error);
+      return;
+    }
+
+  latency = g_timer_elapsed (priv->ping_timer, NULL) * 1000.0;
+
+  health->n_replies++;
+  health->last_latency   = latency;
+  health->total_latency += latency;
+
+  if (latency > health->max_latency)
+    health->max_latency = latency;
+
+  health->unresponsive = FALSE;
+}
+
+/*
+ * Pings the panel process to check it is responsive; if the previous ping
+ * has not been answered yet, the panel is marked as unresponsive, and no new
+ * ping is sent.
+ */
+void
+mnb_panel_oop_ping (MnbPanelOop *panel)
+{
+  MnbPanelOopPrivate *priv = panel->priv;
+
+  if (!priv->proxy || !priv->initialized || priv->dead)
+    return;
+
+  if (priv->ping_call)
+    {
+      priv->health.n_missed++;
+      priv->health.unresponsive = TRUE;
+      return;
+    }
+
+  if (!priv->ping_timer)
+    priv->ping_timer = g_timer_new ();
+  else
+    g_timer_start (priv->ping_timer);
+
+  priv->health.n_pings++;
+
+  priv->ping_call =
+    com_meego_UX_Shell_Panel_ping_async (priv->proxy,
+                                         mnb_panel_oop_ping_reply_cb,
+                                         panel);
+}
+
+const MnbPanelOopHealth *
+mnb_panel_oop_get_health (MnbPanelOop *panel)
+{
+  return &panel->priv->health;
+}
+
 void
 mnb_panel_oop_set_delayed_show (MnbPanelOop *panel, gboolean delayed)
 {
@@ -64,6 +64,20 @@ typedef struct {
   void (*remote_process_died)   (MnbPanelOop *panel);
 } MnbPanelOopClass;
 
+/*
+ * Responsiveness of the panel process, as measured by mnb_panel_oop_ping();
+ * the latencies are in milliseconds.
+ */
+typedef struct {
+  guint    n_pings;
+  guint    n_replies;
+  guint    n_missed;      /* pings still unanswered at the time of next ping */
+  gdouble  last_latency;
+  gdouble  max_latency;
+  gdouble  total_latency;
+  gboolean unresponsive;  /* the last ping has not been answered in time */
+} MnbPanelOopHealth;
+
 GType mnb_panel_oop_get_type (void);
 
 MnbPanelOop *mnb_panel_oop_new (const gchar  *dbus_name,
@@ -91,6 +105,12 @@ void          mnb_panel_oop_hide_animate      (MnbPanelOop  *panel,
                                                MutterWindow *mcw);
 
 void          mnb_panel_oop_unload            (MnbPanelOop *panel);
+void          mnb_panel_oop_name_owner_changed (MnbPanelOop *panel,
+                                                const gchar *old_owner,
+                                                const gchar *new_owner);
+
+void          mnb_panel_oop_ping              (MnbPanelOop *panel);
+const MnbPanelOopHealth *mnb_panel_oop_get_health (MnbPanelOop *panel);
 
 void          mnb_panel_oop_set_delayed_show  (MnbPanelOop *panel,
                                                gboolean     delayed);
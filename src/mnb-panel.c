@@ -344,6 +344,33 @@ mnb_panel_get_position (MnbPanel *panel, gint *x, gint *y)
   iface->get_position (panel, x, y);
 }
 
+/*
+ * Sets position and size of the panel at the same time; panels that do not
+ * implement set_geometry get separate set_position and set_size calls.
+ */
+void
+mnb_panel_set_geometry (MnbPanel *panel,
+                        gint      x,
+                        gint      y,
+                        guint     width,
+                        guint     height)
+{
+  MnbPanelIface *iface;
+
+  g_return_if_fail (MNB_IS_PANEL (panel));
+
+  iface = MNB_PANEL_GET_IFACE (panel);
+
+  if (!iface->set_geometry)
+    {
+      mnb_panel_set_position (panel, x, y);
+      mnb_panel_set_size (panel, width, height);
+      return;
+    }
+
+  iface->set_geometry (panel, x, y, width, height);
+}
+
 gboolean
 mnb_panel_is_mapped (MnbPanel *panel)
 {
@@ -83,6 +83,11 @@ typedef struct {
   void          (*get_position)        (MnbPanel *panel,
                                         gint     *x,
                                         gint     *y);
+  void          (*set_geometry)        (MnbPanel *panel,
+                                        gint      x,
+                                        gint      y,
+                                        guint     width,
+                                        guint     height);
   void          (*set_button)          (MnbPanel *panel, MxButton *button);
 } MnbPanelIface;
 
@@ -128,6 +133,11 @@ void             mnb_panel_set_position      (MnbPanel *panel,
 void             mnb_panel_get_position      (MnbPanel *panel,
                                               gint     *x,
                                               gint     *y);
+void             mnb_panel_set_geometry      (MnbPanel *panel,
+                                              gint      x,
+                                              gint      y,
+                                              guint     width,
+                                              guint     height);
 void             mnb_panel_show              (MnbPanel *panel);
 void             mnb_panel_hide              (MnbPanel *panel);
 void             mnb_panel_hide_with_toolbar (MnbPanel *panel,
@@ -0,0 +1,749 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-thumbnail.c */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "mnb-thumbnail.h"
+
+#include <clutter/x11/clutter-x11.h>
+
+/*
+ * A downscaled copy of a window, for use in the alttab overlay and the zones
+ * preview.
+ *
+ * Sampling the full size window textures to paint small previews is wasteful,
+ * in particular when there are many windows shown at once. The thumbnail
+ * keeps a copy of the window texture, scaled down to fit into the maximum
+ * size it was created with, in an offscreen buffer. The copy is refreshed
+ * lazily: damage to the window only marks it dirty, and it is redrawn when
+ * the thumbnail is next painted. The copy is freed when the thumbnail is
+ * unmapped, so that hidden thumbnails (such as those of the zones preview,
+ * which is kept around between workspace switches) hold no video memory.
+ *
+ * When the thumbnail is painted at a size larger than the copy (e.g., while
+ * the zones preview is zooming in), it paints a clone of the window instead,
+ * so the result is never worse than a plain clone. This also applies when
+ * offscreen rendering is not available. The copy ignores the window shape.
+ */
+
+G_DEFINE_TYPE (MnbThumbnail, mnb_thumbnail, CLUTTER_TYPE_ACTOR);
+
+#define MNB_THUMBNAIL_GET_PRIVATE(obj)    \
+        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), MNB_TYPE_THUMBNAIL, MnbThumbnailPrivate))
+
+enum
+{
+  PROP_0 = 0,
+
+  PROP_MUTTER_WINDOW,
+  PROP_MAX_WIDTH,
+  PROP_MAX_HEIGHT
+};
+
+struct _MnbThumbnailPrivate
+{
+  MutterWindow *mcw;
+  ClutterActor *source;          /* the window texture */
+  ClutterActor *clone;
+
+  gfloat        max_width;
+  gfloat        max_height;
+
+  CoglHandle    texture;         /* the downscaled copy */
+  CoglHandle    fbo;
+  CoglHandle    material;        /* for painting the copy */
+  CoglHandle    source_material; /* for painting into the copy */
+  guint         width;           /* size of the copy */
+  guint         height;
+
+  gboolean      dirty      : 1;
+  gboolean      no_offscreen : 1;
+  gboolean      disposed   : 1;
+};
+
+/*
+ * Large reductions are done in steps, halving the size each time, until the
+ * image is within 2x of the copy size; a single linear sample would alias
+ * badly otherwise. The intermediate images go into two scratch buffers,
+ * which are shared by all thumbnails (the copies are only ever updated one
+ * at a time), and used in turns; they only grow, and are freed when no
+ * thumbnail is mapped.
+ */
+#define MNB_THUMBNAIL_MAX_STEPS 8
+
+typedef struct
+{
+  CoglHandle texture;
+  CoglHandle fbo;
+  CoglHandle material;
+  guint      width;
+  guint      height;
+} MnbThumbnailScratch;
+
+static MnbThumbnailScratch scratch[2] =
+{
+  { COGL_INVALID_HANDLE, COGL_INVALID_HANDLE, COGL_INVALID_HANDLE, 0, 0 },
+  { COGL_INVALID_HANDLE, COGL_INVALID_HANDLE, COGL_INVALID_HANDLE, 0, 0 }
+};
+
+static guint n_mapped_thumbnails = 0;
+
+static void
+mnb_thumbnail_release_scratch (MnbThumbnailScratch *buf)
+{
+  if (buf->fbo != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (buf->fbo);
+      buf->fbo = COGL_INVALID_HANDLE;
+    }
+
+  if (buf->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (buf->texture);
+      buf->texture = COGL_INVALID_HANDLE;
+    }
+
+  if (buf->material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (buf->material);
+      buf->material = COGL_INVALID_HANDLE;
+    }
+
+  buf->width  = 0;
+  buf->height = 0;
+}
+
+static gboolean
+mnb_thumbnail_ensure_scratch (MnbThumbnailScratch *buf,
+                              guint                width,
+                              guint                height)
+{
+  if (buf->fbo != COGL_INVALID_HANDLE &&
+      buf->width >= width && buf->height >= height)
+    return TRUE;
+
+  width  = MAX (width, buf->width);
+  height = MAX (height, buf->height);
+
+  mnb_thumbnail_release_scratch (buf);
+
+  buf->texture = cogl_texture_new_with_size (width, height,
+                                             COGL_TEXTURE_NO_SLICING,
+                                             COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+
+  if (buf->texture != COGL_INVALID_HANDLE)
+    buf->fbo = cogl_offscreen_new_to_texture (buf->texture);
+
+  if (buf->fbo == COGL_INVALID_HANDLE)
+    {
+      mnb_thumbnail_release_scratch (buf);
+      return FALSE;
+    }
+
+  buf->material = cogl_material_new ();
+  cogl_material_set_layer (buf->material, 0, buf->texture);
+  cogl_material_set_layer_filters (buf->material, 0,
+                                   COGL_MATERIAL_FILTER_LINEAR,
+                                   COGL_MATERIAL_FILTER_LINEAR);
+
+  buf->width  = width;
+  buf->height = height;
+
+  return TRUE;
+}
+
+static void
+mnb_thumbnail_release_copy (MnbThumbnail *thumbnail)
+{
+  MnbThumbnailPrivate *priv = thumbnail->priv;
+
+  if (priv->fbo != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->fbo);
+      priv->fbo = COGL_INVALID_HANDLE;
+    }
+
+  if (priv->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->texture);
+      priv->texture = COGL_INVALID_HANDLE;
+    }
+
+  priv->width  = 0;
+  priv->height = 0;
+}
+
+static void
+mnb_thumbnail_source_damaged_cb (ClutterActor *source,
+                                 gint          x,
+                                 gint          y,
+                                 gint          width,
+                                 gint          height,
+                                 MnbThumbnail *thumbnail)
+{
+  MnbThumbnailPrivate *priv = thumbnail->priv;
+
+  priv->dirty = TRUE;
+
+  if (CLUTTER_ACTOR_IS_MAPPED (thumbnail))
+    clutter_actor_queue_redraw (CLUTTER_ACTOR (thumbnail));
+}
+
+static void
+mnb_thumbnail_source_texture_notify_cb (ClutterActor *source,
+                                        GParamSpec   *pspec,
+                                        MnbThumbnail *thumbnail)
+{
+  MnbThumbnailPrivate *priv = thumbnail->priv;
+
+  priv->dirty = TRUE;
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (thumbnail));
+}
+
+static void mnb_thumbnail_source_destroy_cb (ClutterActor *source,
+                                             MnbThumbnail *thumbnail);
+
+static void
+mnb_thumbnail_disconnect_source (MnbThumbnail *thumbnail)
+{
+  MnbThumbnailPrivate *priv = thumbnail->priv;
+
+  if (!priv->source)
+    return;
+
+  g_signal_handlers_disconnect_by_func (priv->source,
+                                        mnb_thumbnail_source_damaged_cb,
+                                        thumbnail);
+  g_signal_handlers_disconnect_by_func (priv->source,
+                                        mnb_thumbnail_source_texture_notify_cb,
+                                        thumbnail);
+  g_signal_handlers_disconnect_by_func (priv->source,
+                                        mnb_thumbnail_source_destroy_cb,
+                                        thumbnail);
+
+  priv->source = NULL;
+}
+
+/*
+ * The window is going away; we keep the last copy (if any) for the rest of
+ * our life.
+ */
+static void
+mnb_thumbnail_source_destroy_cb (ClutterActor *source,
+                                 MnbThumbnail *thumbnail)
+{
+  mnb_thumbnail_disconnect_source (thumbnail);
+}
+
+static void
+mnb_thumbnail_dispose (GObject *object)
+{
+  MnbThumbnail        *thumbnail = MNB_THUMBNAIL (object);
+  MnbThumbnailPrivate *priv      = thumbnail->priv;
+
+  if (priv->disposed)
+    return;
+
+  priv->disposed = TRUE;
+
+  mnb_thumbnail_disconnect_source (thumbnail);
+
+  if (priv->clone)
+    {
+      clutter_actor_destroy (priv->clone);
+      priv->clone = NULL;
+    }
+
+  mnb_thumbnail_release_copy (thumbnail);
+
+  if (priv->material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->material);
+      priv->material = COGL_INVALID_HANDLE;
+    }
+
+  if (priv->source_material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->source_material);
+      priv->source_material = COGL_INVALID_HANDLE;
+    }
+
+  G_OBJECT_CLASS (mnb_thumbnail_parent_class)->dispose (object);
+}
+
+/*
+ * Computes the size of the copy for the given source size; the copy is never
+ * larger than the source.
+ */
+static void
+mnb_thumbnail_get_copy_size (MnbThumbnail *thumbnail,
+                             guint         source_width,
+                             guint         source_height,
+                             guint        *width,
+                             guint        *height)
+{
+  MnbThumbnailPrivate *priv  = thumbnail->priv;
+  gdouble              scale = 1.0;
+
+  if (source_width > priv->max_width)
+    scale = priv->max_width / source_width;
+
+  if (source_height * scale > priv->max_height)
+    scale = priv->max_height / source_height;
+
+  *width  = MAX (1, (guint) (source_width * scale));
+  *height = MAX (1, (guint) (source_height * scale));
+}
+
+/*
+ * Redraws the downscaled copy of the window; returns FALSE if there is no
+ * copy to paint.
+ */
+static gboolean
+mnb_thumbnail_update_copy (MnbThumbnail *thumbnail)
+{
+  MnbThumbnailPrivate *priv = thumbnail->priv;
+  CoglHandle           source;
+  CoglHandle           input;
+  CoglColor            transparent;
+  guint                width, height;
+  guint                step_width, step_height;
+  gfloat               tx, ty;
+  gint                 n_steps, i;
+
+  if (!priv->dirty)
+    return priv->texture != COGL_INVALID_HANDLE;
+
+  if (!priv->source)
+    return priv->texture != COGL_INVALID_HANDLE;
+
+  source = clutter_texture_get_cogl_texture (CLUTTER_TEXTURE (priv->source));
+
+  if (source == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  mnb_thumbnail_get_copy_size (thumbnail,
+                               cogl_texture_get_width (source),
+                               cogl_texture_get_height (source),
+                               &width, &height);
+
+  if (priv->texture == COGL_INVALID_HANDLE ||
+      width != priv->width || height != priv->height)
+    {
+      mnb_thumbnail_release_copy (thumbnail);
+
+      priv->texture =
+        cogl_texture_new_with_size (width, height,
+                                    COGL_TEXTURE_NO_SLICING,
+                                    COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+
+      if (priv->texture != COGL_INVALID_HANDLE)
+        priv->fbo = cogl_offscreen_new_to_texture (priv->texture);
+
+      if (priv->fbo == COGL_INVALID_HANDLE)
+        {
+          g_warning ("Could not create offscreen buffer for thumbnail, "
+                     "falling back to clones");
+
+          mnb_thumbnail_release_copy (thumbnail);
+          priv->no_offscreen = TRUE;
+          return FALSE;
+        }
+
+      priv->width  = width;
+      priv->height = height;
+
+      cogl_material_set_layer (priv->material, 0, priv->texture);
+    }
+
+  /*
+   * No mipmapping here: the window texture changes with every damage, and
+   * regenerating its mipmaps each time would cost more than the copy saves;
+   * instead, the window is reduced in 2x steps (see MnbThumbnailScratch).
+   */
+  cogl_material_set_layer (priv->source_material, 0, source);
+  cogl_material_set_layer_filters (priv->source_material, 0,
+                                   COGL_MATERIAL_FILTER_LINEAR,
+                                   COGL_MATERIAL_FILTER_LINEAR);
+
+  step_width  = cogl_texture_get_width (source);
+  step_height = cogl_texture_get_height (source);
+
+  for (n_steps = 0; n_steps < MNB_THUMBNAIL_MAX_STEPS; n_steps++)
+    {
+      step_width  /= 2;
+      step_height /= 2;
+
+      if (step_width < width || step_height < height)
+        break;
+
+      /*
+       * The first step is the largest for either buffer.
+       */
+      if (n_steps < 2 &&
+          !mnb_thumbnail_ensure_scratch (&scratch[n_steps],
+                                         step_width, step_height))
+        break;
+    }
+
+  cogl_color_set_from_4ub (&transparent, 0, 0, 0, 0);
+
+  input       = priv->source_material;
+  tx          = 1.0;
+  ty          = 1.0;
+  step_width  = cogl_texture_get_width (source);
+  step_height = cogl_texture_get_height (source);
+
+  for (i = 0; i < n_steps; i++)
+    {
+      MnbThumbnailScratch *buf = &scratch[i % 2];
+
+      step_width  /= 2;
+      step_height /= 2;
+
+      cogl_push_framebuffer (buf->fbo);
+
+      cogl_ortho (0, buf->width, buf->height, 0, -1.0, 1.0);
+      cogl_clear (&transparent, COGL_BUFFER_BIT_COLOR);
+
+      cogl_set_source (input);
+      cogl_rectangle_with_texture_coords (0, 0, step_width, step_height,
+                                          0, 0, tx, ty);
+
+      cogl_pop_framebuffer ();
+
+      input = buf->material;
+      tx    = (gfloat) step_width / buf->width;
+      ty    = (gfloat) step_height / buf->height;
+    }
+
+  cogl_push_framebuffer (priv->fbo);
+
+  cogl_ortho (0, width, height, 0, -1.0, 1.0);
+  cogl_clear (&transparent, COGL_BUFFER_BIT_COLOR);
+
+  cogl_set_source (input);
+  cogl_rectangle_with_texture_coords (0, 0, width, height, 0, 0, tx, ty);
+
+  cogl_pop_framebuffer ();
+
+  priv->dirty = FALSE;
+
+  return TRUE;
+}
+
+static void
+mnb_thumbnail_paint (ClutterActor *actor)
+{
+  MnbThumbnail        *thumbnail = MNB_THUMBNAIL (actor);
+  MnbThumbnailPrivate *priv      = thumbnail->priv;
+  ClutterActorBox      box;
+  gfloat               width, height;
+  guint8               opacity;
+
+  /*
+   * Use the clone if the copy would have to be scaled up (we allow for a
+   * pixel of rounding error).
+   */
+  clutter_actor_get_transformed_size (actor, &width, &height);
+
+  if (priv->no_offscreen ||
+      (priv->source &&
+       (width > priv->max_width + 1.0 || height > priv->max_height + 1.0)) ||
+      !mnb_thumbnail_update_copy (thumbnail) ||
+      (priv->source &&
+       (width > priv->width + 1.0 || height > priv->height + 1.0)))
+    {
+      if (priv->clone && CLUTTER_ACTOR_IS_MAPPED (priv->clone))
+        clutter_actor_paint (priv->clone);
+
+      return;
+    }
+
+  clutter_actor_get_allocation_box (actor, &box);
+
+  opacity = clutter_actor_get_paint_opacity (actor);
+
+  cogl_material_set_color4ub (priv->material,
+                              opacity, opacity, opacity, opacity);
+  cogl_set_source (priv->material);
+  cogl_rectangle (0, 0, box.x2 - box.x1, box.y2 - box.y1);
+}
+
+static void
+mnb_thumbnail_get_preferred_width (ClutterActor *actor,
+                                   gfloat        for_height,
+                                   gfloat       *min_width_p,
+                                   gfloat       *natural_width_p)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (actor)->priv;
+
+  if (priv->source)
+    {
+      clutter_actor_get_preferred_width (priv->source, for_height,
+                                         min_width_p, natural_width_p);
+      return;
+    }
+
+  if (min_width_p)
+    *min_width_p = 0.0;
+
+  if (natural_width_p)
+    *natural_width_p = 0.0;
+}
+
+static void
+mnb_thumbnail_get_preferred_height (ClutterActor *actor,
+                                    gfloat        for_width,
+                                    gfloat       *min_height_p,
+                                    gfloat       *natural_height_p)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (actor)->priv;
+
+  if (priv->source)
+    {
+      clutter_actor_get_preferred_height (priv->source, for_width,
+                                          min_height_p, natural_height_p);
+      return;
+    }
+
+  if (min_height_p)
+    *min_height_p = 0.0;
+
+  if (natural_height_p)
+    *natural_height_p = 0.0;
+}
+
+static void
+mnb_thumbnail_allocate (ClutterActor          *actor,
+                        const ClutterActorBox *box,
+                        ClutterAllocationFlags flags)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (actor)->priv;
+
+  CLUTTER_ACTOR_CLASS (mnb_thumbnail_parent_class)->allocate (actor,
+                                                              box, flags);
+
+  if (priv->clone)
+    {
+      ClutterActorBox child_box;
+
+      child_box.x1 = 0.0;
+      child_box.y1 = 0.0;
+      child_box.x2 = box->x2 - box->x1;
+      child_box.y2 = box->y2 - box->y1;
+
+      clutter_actor_allocate (priv->clone, &child_box, flags);
+    }
+}
+
+static void
+mnb_thumbnail_map (ClutterActor *actor)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (actor)->priv;
+
+  CLUTTER_ACTOR_CLASS (mnb_thumbnail_parent_class)->map (actor);
+
+  if (priv->clone)
+    clutter_actor_map (priv->clone);
+
+  n_mapped_thumbnails++;
+}
+
+static void
+mnb_thumbnail_unmap (ClutterActor *actor)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (actor)->priv;
+
+  CLUTTER_ACTOR_CLASS (mnb_thumbnail_parent_class)->unmap (actor);
+
+  if (priv->clone)
+    clutter_actor_unmap (priv->clone);
+
+  mnb_thumbnail_release_copy (MNB_THUMBNAIL (actor));
+  priv->dirty = TRUE;
+
+  if (!--n_mapped_thumbnails)
+    {
+      mnb_thumbnail_release_scratch (&scratch[0]);
+      mnb_thumbnail_release_scratch (&scratch[1]);
+    }
+}
+
+static void
+mnb_thumbnail_constructed (GObject *object)
+{
+  MnbThumbnail        *thumbnail = MNB_THUMBNAIL (object);
+  MnbThumbnailPrivate *priv      = thumbnail->priv;
+
+  if (G_OBJECT_CLASS (mnb_thumbnail_parent_class)->constructed)
+    G_OBJECT_CLASS (mnb_thumbnail_parent_class)->constructed (object);
+
+  g_assert (priv->mcw);
+
+  priv->source = mutter_window_get_texture (priv->mcw);
+
+  priv->clone = clutter_clone_new (priv->source);
+  clutter_actor_set_parent (priv->clone, CLUTTER_ACTOR (thumbnail));
+
+  priv->material        = cogl_material_new ();
+  priv->source_material = cogl_material_new ();
+
+  if (CLUTTER_X11_IS_TEXTURE_PIXMAP (priv->source))
+    g_signal_connect (priv->source, "queue-damage-redraw",
+                      G_CALLBACK (mnb_thumbnail_source_damaged_cb),
+                      thumbnail);
+
+  g_signal_connect (priv->source, "notify::cogl-texture",
+                    G_CALLBACK (mnb_thumbnail_source_texture_notify_cb),
+                    thumbnail);
+  g_signal_connect (priv->source, "destroy",
+                    G_CALLBACK (mnb_thumbnail_source_destroy_cb),
+                    thumbnail);
+}
+
+static void
+mnb_thumbnail_set_property (GObject      *gobject,
+                            guint         prop_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (gobject)->priv;
+
+  switch (prop_id)
+    {
+    case PROP_MUTTER_WINDOW:
+      priv->mcw = g_value_get_object (value);
+      break;
+    case PROP_MAX_WIDTH:
+      priv->max_width = g_value_get_float (value);
+      break;
+    case PROP_MAX_HEIGHT:
+      priv->max_height = g_value_get_float (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+mnb_thumbnail_get_property (GObject    *gobject,
+                            guint       prop_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+  MnbThumbnailPrivate *priv = MNB_THUMBNAIL (gobject)->priv;
+
+  switch (prop_id)
+    {
+    case PROP_MUTTER_WINDOW:
+      g_value_set_object (value, priv->mcw);
+      break;
+    case PROP_MAX_WIDTH:
+      g_value_set_float (value, priv->max_width);
+      break;
+    case PROP_MAX_HEIGHT:
+      g_value_set_float (value, priv->max_height);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+mnb_thumbnail_class_init (MnbThumbnailClass *klass)
+{
+  GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class  = CLUTTER_ACTOR_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MnbThumbnailPrivate));
+
+  object_class->dispose             = mnb_thumbnail_dispose;
+  object_class->get_property        = mnb_thumbnail_get_property;
+  object_class->set_property        = mnb_thumbnail_set_property;
+  object_class->constructed         = mnb_thumbnail_constructed;
+
+  actor_class->paint                = mnb_thumbnail_paint;
+  actor_class->get_preferred_width  = mnb_thumbnail_get_preferred_width;
+  actor_class->get_preferred_height = mnb_thumbnail_get_preferred_height;
+  actor_class->allocate             = mnb_thumbnail_allocate;
+  actor_class->map                  = mnb_thumbnail_map;
+  actor_class->unmap                = mnb_thumbnail_unmap;
+
+  g_object_class_install_property (object_class,
+                                   PROP_MUTTER_WINDOW,
+                                   g_param_spec_object ("mutter-window",
+                                                        "Mutter Window",
+                                                        "Mutter Window",
+                                                        MUTTER_TYPE_COMP_WINDOW,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class,
+                                   PROP_MAX_WIDTH,
+                                   g_param_spec_float ("max-width",
+                                                       "Max width",
+                                                       "Maximum width of the "
+                                                       "downscaled copy",
+                                                       1.0, G_MAXFLOAT, 256.0,
+                                                       G_PARAM_READWRITE |
+                                                       G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class,
+                                   PROP_MAX_HEIGHT,
+                                   g_param_spec_float ("max-height",
+                                                       "Max height",
+                                                       "Maximum height of the "
+                                                       "downscaled copy",
+                                                       1.0, G_MAXFLOAT, 256.0,
+                                                       G_PARAM_READWRITE |
+                                                       G_PARAM_CONSTRUCT_ONLY));
+}
+
+static void
+mnb_thumbnail_init (MnbThumbnail *self)
+{
+  MnbThumbnailPrivate *priv;
+
+  priv = self->priv = MNB_THUMBNAIL_GET_PRIVATE (self);
+
+  priv->texture         = COGL_INVALID_HANDLE;
+  priv->fbo             = COGL_INVALID_HANDLE;
+  priv->material        = COGL_INVALID_HANDLE;
+  priv->source_material = COGL_INVALID_HANDLE;
+  priv->dirty           = TRUE;
+}
+
+/*
+ * Creates a thumbnail of the given window; the downscaled copy is at most
+ * max_width x max_height.
+ */
+ClutterActor *
+mnb_thumbnail_new (MutterWindow *mcw, gfloat max_width, gfloat max_height)
+{
+  return g_object_new (MNB_TYPE_THUMBNAIL,
+                       "mutter-window", mcw,
+                       "max-width",     max_width,
+                       "max-height",    max_height,
+                       NULL);
+}
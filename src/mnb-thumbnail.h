@@ -0,0 +1,70 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* mnb-thumbnail.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+
+#ifndef _MNB_THUMBNAIL
+#define _MNB_THUMBNAIL
+
+#include <clutter/clutter.h>
+#include <mutter-plugin.h>
+
+G_BEGIN_DECLS
+
+#define MNB_TYPE_THUMBNAIL mnb_thumbnail_get_type()
+
+#define MNB_THUMBNAIL(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MNB_TYPE_THUMBNAIL, MnbThumbnail))
+
+#define MNB_THUMBNAIL_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MNB_TYPE_THUMBNAIL, MnbThumbnailClass))
+
+#define MNB_IS_THUMBNAIL(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MNB_TYPE_THUMBNAIL))
+
+#define MNB_IS_THUMBNAIL_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MNB_TYPE_THUMBNAIL))
+
+#define MNB_THUMBNAIL_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MNB_TYPE_THUMBNAIL, MnbThumbnailClass))
+
+typedef struct _MnbThumbnailPrivate MnbThumbnailPrivate;
+
+typedef struct {
+  ClutterActor parent;
+
+  /*< private >*/
+  MnbThumbnailPrivate *priv;
+} MnbThumbnail;
+
+typedef struct {
+  ClutterActorClass parent_class;
+} MnbThumbnailClass;
+
+GType mnb_thumbnail_get_type (void);
+
+ClutterActor *mnb_thumbnail_new (MutterWindow *mcw,
+                                 gfloat        max_width,
+                                 gfloat        max_height);
+
+G_END_DECLS
+
+#endif /* _MNB_THUMBNAIL */
@@ -27,12 +27,20 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <dbus/dbus-glib.h>
 #include <dbus/dbus-glib-bindings.h>
 #include <dbus/dbus-glib-lowlevel.h>
 #include <dbus/dbus.h>
 #include <gconf/gconf-client.h>
 #include <meego-panel/mpl-panel-common.h>
+#include <meego-panel/mpl-toolbar-state.h>
 #include <display.h>
 #include <keybindings.h>
 #include <errors.h>
@@ -55,6 +63,7 @@
 #include "mnb-toolbar-icon.h"
 #include "mnb-toolbar-clock.h"
 #include "mnb-spinner.h"
+#include "mnb-paint-profiler.h"
 
 /* For systray windows stuff */
 #include <gdk/gdkx.h>
@@ -92,6 +101,14 @@
 #define TOOLBAR_AUTOSTART_ATTEMPTS 10
 #define TOOLBAR_WAITING_FOR_PANEL_TIMEOUT 1 /* in seconds */
 #define TOOLBAR_PANEL_STUB_TIMEOUT 6        /* in seconds */
+#define TOOLBAR_PREWARM_INTERVAL 1          /* in seconds */
+#define TOOLBAR_IDLE_UNLOAD_CHECK 60        /* in seconds */
+#define TOOLBAR_IDLE_UNLOAD_TIMEOUT (10 * 60) /* in seconds */
+#define TOOLBAR_HEALTH_CHECK_INTERVAL 10    /* in seconds */
+#define TOOLBAR_PANEL_HEALTHY_UPTIME 60     /* in seconds */
+#define TOOLBAR_PANEL_MAX_QUICK_DEATHS 5
+#define TOOLBAR_PANEL_MAX_RESTART_DELAY 64  /* in seconds */
+#define TOOLBAR_STARTUP_TRACE_MAX 8192      /* in bytes */
 #define MEEGO_BOOT_COUNT_KEY "/desktop/meego/myzone/boot_count"
 
 #define CLOSE_BUTTON_GUARD_WIDTH 35
@@ -138,6 +155,7 @@ static gboolean mnb_toolbar_stage_input_cb (ClutterActor *stage,
 static void mnb_toolbar_stage_show_cb (ClutterActor *stage,
                                        MnbToolbar *toolbar);
 static void mnb_toolbar_handle_dbus_name (MnbToolbar *, const gchar *);
+static gboolean mnb_toolbar_is_panel_pending (MnbToolbar *, const gchar *);
 static MnbPanel * mnb_toolbar_panel_name_to_panel (MnbToolbar  *toolbar,
                                                    const gchar *name);
 static MnbToolbarPanel * mnb_toolbar_panel_name_to_panel_internal (MnbToolbar  *toolbar,
@@ -152,6 +170,9 @@ static gboolean mnb_toolbar_start_panel_service (MnbToolbar *toolbar,
                                                  MnbToolbarPanel *tp);
 static void mnb_toolbar_workarea_changed_cb (MetaScreen *screen,
                                              MnbToolbar *toolbar);
+static void mnb_toolbar_ensure_size_for_screen (MnbToolbar *toolbar);
+static void mnb_toolbar_queue_state_update (MnbToolbar *toolbar);
+static void mnb_toolbar_setup_health_monitor (MnbToolbar *toolbar);
 
 enum {
   PROP_0,
@@ -196,11 +217,49 @@ struct _MnbToolbarPanel
   gboolean    pinged     : 1;
   gboolean    required   : 1;
   gboolean    failed     : 1;
+  gboolean    prewarmed  : 1; /* service started by the pre-warm timeout */
+  gboolean    show_cold  : 1; /* pending show had to start the service */
+  gboolean    idle_unloaded : 1; /* unloaded by the lazy-panels policy */
+
+  gdouble     last_used;      /* last time the panel was shown or hidden,
+                               * or appeared, per the startup_timer */
+  guint       n_idle_unloads;
+  guint       rss_kb;         /* RSS of the process at the last unload */
+
+  /*
+   * Restart backoff; a panel that dies within TOOLBAR_PANEL_HEALTHY_UPTIME of
+   * appearing counts as a quick death, and is restarted with an exponentially
+   * growing delay; after TOOLBAR_PANEL_MAX_QUICK_DEATHS in a row we consider
+   * the panel to be in a crash loop and stop restarting it automatically.
+   */
+  gdouble     appeared;       /* when the current panel object was appended */
+  guint       n_restarts;
+  guint       n_quick_deaths;
+  guint       restart_id;
+  gboolean    crash_loop   : 1;
+  gboolean    unresponsive : 1; /* last known state of the panel health */
+
+  /*
+   * Show latency, from the show request to the panel show-completed signal;
+   * the times are in seconds, as returned by the Toolbar startup_timer.
+   */
+  gdouble     show_requested; /* 0.0 if no show pending */
+  guint       n_shows;
+  guint       n_cold_shows;
+  gdouble     first_show_latency;
+  gdouble     last_show_latency;
+  gdouble     total_show_latency;
 };
 
 static void
 mnb_toolbar_panel_destroy (MnbToolbarPanel *tp)
 {
+  if (tp->restart_id)
+    {
+      g_source_remove (tp->restart_id);
+      tp->restart_id = 0;
+    }
+
   g_free (tp->name);
   g_free (tp->service);
   g_free (tp->button_stylesheet);
@@ -214,6 +273,39 @@ mnb_toolbar_panel_destroy (MnbToolbarPanel *tp)
     g_critical (G_STRLOC ": panel leaked");
 }
 
+/*
+ * Identifies a panel in asynchronous callbacks; we store the service name
+ * rather than the MnbToolbarPanel, as the latter might be gone by the time
+ * the callback runs.
+ */
+typedef struct
+{
+  MnbToolbar     *toolbar;
+  gchar          *service;
+  DBusGProxyCall *call; /* pending dbus call, if any */
+} MnbToolbarServiceData;
+
+static MnbToolbarServiceData *
+mnb_toolbar_service_data_new (MnbToolbar *toolbar, const gchar *service)
+{
+  MnbToolbarServiceData *sd = g_slice_new (MnbToolbarServiceData);
+
+  sd->toolbar = toolbar;
+  sd->service = g_strdup (service);
+  sd->call    = NULL;
+
+  return sd;
+}
+
+static void
+mnb_toolbar_service_data_free (gpointer data)
+{
+  MnbToolbarServiceData *sd = data;
+
+  g_free (sd->service);
+  g_slice_free (MnbToolbarServiceData, sd);
+}
+
 struct _MnbToolbarPrivate
 {
   MutterPlugin *plugin;
@@ -275,6 +367,7 @@ struct _MnbToolbarPrivate
 
   DBusGConnection *dbus_conn;
   DBusGProxy      *dbus_proxy;
+  GList           *pid_calls; /* MnbToolbarServiceData of pending pid calls */
 
   GSList          *pending_panels;
   MnbToolbarPanel *tp_to_activate;
@@ -286,6 +379,16 @@ struct _MnbToolbarPrivate
   guint            waiting_for_panel_hide_cb_id;
   guint            panel_stub_timeout_id;
   guint            trigger_cb_id;
+  guint            prewarm_id;
+  guint            idle_unload_id;
+  guint            health_id;
+  guint            state_update_id;
+
+  MplToolbarStateSegment *state; /* see mnb_toolbar_setup_state() */
+
+  GTimer          *startup_timer; /* Time since the Toolbar was created */
+  GString         *startup_trace; /* Panel discovery events, see
+                                   * mnb_toolbar_trace_startup() */
 };
 
 static void
@@ -323,6 +426,25 @@ mnb_toolbar_set_property (GObject *object, guint property_id,
     }
 }
 
+/*
+ * Publishes the snapshot in the Toolbar state segment (see
+ * mnb_toolbar_setup_state()); we are the only writer, so the sequence is
+ * simply bumped to odd for the duration of the update, and back to even.
+ */
+static void
+mnb_toolbar_write_state (MplToolbarStateSegment        *segment,
+                         const MplToolbarStateSnapshot *snapshot)
+{
+  if (!memcmp (&segment->snapshot, snapshot, sizeof (MplToolbarStateSnapshot)))
+    return;
+
+  g_atomic_int_inc (&segment->sequence);
+
+  memcpy (&segment->snapshot, snapshot, sizeof (MplToolbarStateSnapshot));
+
+  g_atomic_int_inc (&segment->sequence);
+}
+
 static void
 mnb_toolbar_dispose (GObject *object)
 {
@@ -334,6 +456,58 @@ mnb_toolbar_dispose (GObject *object)
       priv->dbus_conn = NULL;
     }
 
+  if (priv->prewarm_id)
+    {
+      g_source_remove (priv->prewarm_id);
+      priv->prewarm_id = 0;
+    }
+
+  if (priv->idle_unload_id)
+    {
+      g_source_remove (priv->idle_unload_id);
+      priv->idle_unload_id = 0;
+    }
+
+  if (priv->health_id)
+    {
+      g_source_remove (priv->health_id);
+      priv->health_id = 0;
+    }
+
+  /*
+   * The replies would arrive to a dead toolbar.
+   */
+  while (priv->pid_calls)
+    {
+      MnbToolbarServiceData *ud = priv->pid_calls->data;
+
+      dbus_g_proxy_cancel_call (priv->dbus_proxy, ud->call);
+      mnb_toolbar_service_data_free (ud);
+
+      priv->pid_calls = g_list_delete_link (priv->pid_calls, priv->pid_calls);
+    }
+
+  if (priv->state_update_id)
+    {
+      g_source_remove (priv->state_update_id);
+      priv->state_update_id = 0;
+    }
+
+  if (priv->state)
+    {
+      MplToolbarStateSnapshot *snapshot = g_new0 (MplToolbarStateSnapshot, 1);
+
+      /*
+       * Leave an empty state behind, without the RUNNING flag.
+       */
+      snapshot->active_panel = -1;
+      mnb_toolbar_write_state (priv->state, snapshot);
+      g_free (snapshot);
+
+      munmap (priv->state, sizeof (MplToolbarStateSegment));
+      priv->state = NULL;
+    }
+
   if (priv->input_region)
     {
       mnb_input_manager_remove_region (priv->input_region);
@@ -366,6 +540,9 @@ mnb_toolbar_finalize (GObject *object)
   g_slist_free (priv->pending_panels);
   priv->pending_panels = NULL;
 
+  g_timer_destroy (priv->startup_timer);
+  g_string_free (priv->startup_trace, TRUE);
+
   G_OBJECT_CLASS (mnb_toolbar_parent_class)->finalize (object);
 }
 
@@ -420,6 +597,13 @@ mnb_toolbar_show_lowlight (MnbToolbar *toolbar)
   if (CLUTTER_ACTOR_IS_VISIBLE (lowlight))
     return;
 
+  if (meego_netbook_use_instant_mode (toolbar->priv->plugin))
+    {
+      clutter_actor_set_opacity (lowlight, 0x7f);
+      clutter_actor_show (lowlight);
+      return;
+    }
+
   clutter_actor_set_opacity (lowlight, 0);
   clutter_actor_show (lowlight);
 
@@ -440,6 +624,13 @@ mnb_toolbar_hide_lowlight (MnbToolbar *toolbar)
   if (!CLUTTER_ACTOR_IS_VISIBLE (lowlight))
     return;
 
+  if (meego_netbook_use_instant_mode (toolbar->priv->plugin))
+    {
+      clutter_actor_set_opacity (lowlight, 0);
+      clutter_actor_hide (lowlight);
+      return;
+    }
+
   anim = clutter_actor_animate (CLUTTER_ACTOR(lowlight),
                                 CLUTTER_EASE_IN_SINE,
                                 TOOLBAR_LOWLIGHT_FADE_DURATION,
@@ -501,6 +692,13 @@ mnb_toolbar_show (MnbToolbar *toolbar, MnbShowHideReason reason)
 
   priv->in_show_animation = TRUE;
 
+  if (meego_netbook_use_instant_mode (priv->plugin))
+    {
+      clutter_actor_set_y (actor, 0.0);
+      mnb_toolbar_show_completed_cb (NULL, actor);
+      return;
+    }
+
   /*
    * Start animation and wait for it to complete.
    */
@@ -558,6 +756,8 @@ mnb_toolbar_real_show (ClutterActor *actor)
                                    FALSE, MNB_INPUT_LAYER_PANEL);
 
   meego_netbook_stash_window_focus (priv->plugin, CurrentTime);
+
+  mnb_toolbar_queue_state_update (MNB_TOOLBAR (actor));
 }
 
 static void
@@ -585,6 +785,8 @@ mnb_toolbar_real_hide (ClutterActor *actor)
             mx_button_set_toggled (MX_BUTTON (panel->button), FALSE);
         }
     }
+
+  mnb_toolbar_queue_state_update (MNB_TOOLBAR (actor));
 }
 
 static void
@@ -715,6 +917,13 @@ mnb_toolbar_hide (MnbToolbar *toolbar, MnbShowHideReason reason)
 
   height = clutter_actor_get_height (actor);
 
+  if (meego_netbook_use_instant_mode (priv->plugin))
+    {
+      clutter_actor_set_y (actor, -height);
+      mnb_toolbar_hide_transition_completed_cb (NULL, actor);
+      return;
+    }
+
   /*
    * Start animation and wait for it to complete.
    */
@@ -743,6 +952,16 @@ mnb_toolbar_allocate (ClutterActor          *actor,
   CLUTTER_ACTOR_CLASS (mnb_toolbar_parent_class)->allocate (actor, box, flags);
 }
 
+static void
+mnb_toolbar_paint (ClutterActor *actor)
+{
+  gint64 start = mnb_paint_profiler_begin ();
+
+  CLUTTER_ACTOR_CLASS (mnb_toolbar_parent_class)->paint (actor);
+
+  mnb_paint_profiler_end (MNB_PAINT_STAGE_TOOLBAR, start);
+}
+
 static gboolean
 mnb_toolbar_dbus_show_toolbar (MnbToolbar *self, GError **error)
 {
@@ -796,6 +1015,239 @@ mnb_toolbar_dbus_hide_panel (MnbToolbar  *self,
   return TRUE;
 }
 
+/*
+ * Records a panel startup event, with the time elapsed since the Toolbar was
+ * created; the trace can be retrieved via the GetStartupTrace D-Bus method.
+ *
+ * Panel restarts and lazy loads keep adding events for the whole session, so
+ * the trace only keeps the most recent TOOLBAR_STARTUP_TRACE_MAX bytes worth
+ * of events.
+ */
+static void
+mnb_toolbar_trace_startup (MnbToolbar *toolbar, const gchar *format, ...)
+{
+  MnbToolbarPrivate *priv = toolbar->priv;
+  va_list            args;
+
+  g_string_append_printf (priv->startup_trace, "%9.3f ",
+                          g_timer_elapsed (priv->startup_timer, NULL));
+
+  va_start (args, format);
+  g_string_append_vprintf (priv->startup_trace, format, args);
+  va_end (args);
+
+  g_string_append_c (priv->startup_trace, '\n');
+
+  while (priv->startup_trace->len > TOOLBAR_STARTUP_TRACE_MAX)
+    {
+      gchar *eol = strchr (priv->startup_trace->str, '\n');
+
+      g_string_erase (priv->startup_trace, 0,
+                      eol - priv->startup_trace->str + 1);
+    }
+}
+
+static gboolean
+mnb_toolbar_dbus_get_startup_trace (MnbToolbar  *self,
+                                    gchar      **trace,
+                                    GError     **error)
+{
+  *trace = g_strdup (self->priv->startup_trace->str);
+
+  return TRUE;
+}
+
+/*
+ * Show latency tracking; the latency is measured from the moment the show was
+ * requested (button click, or D-Bus call) to the panel's show-completed signal,
+ * and includes starting the panel service if it was not running.
+ */
+static void
+mnb_toolbar_panel_show_requested (MnbToolbar      *toolbar,
+                                  MnbToolbarPanel *tp,
+                                  gboolean         cold)
+{
+  tp->show_requested = g_timer_elapsed (toolbar->priv->startup_timer, NULL);
+  tp->show_cold      = cold;
+  tp->last_used      = tp->show_requested;
+
+  mnb_toolbar_setup_health_monitor (toolbar);
+}
+
+static void
+mnb_toolbar_panel_show_completed (MnbToolbar *toolbar, MnbToolbarPanel *tp)
+{
+  gdouble latency;
+
+  if (tp->show_requested <= 0.0)
+    return;
+
+  latency = g_timer_elapsed (toolbar->priv->startup_timer, NULL) -
+    tp->show_requested;
+
+  if (!tp->n_shows)
+    tp->first_show_latency = latency;
+
+  tp->n_shows++;
+  tp->last_show_latency   = latency;
+  tp->total_show_latency += latency;
+
+  if (tp->show_cold)
+    tp->n_cold_shows++;
+
+  tp->show_requested = 0.0;
+  tp->show_cold      = FALSE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_show_latency (MnbToolbar  *self,
+                                   gchar      **latency,
+                                   GError     **error)
+{
+  GString *str = g_string_new ("# panel shows cold first-ms last-ms mean-ms\n");
+  GList   *l;
+
+  for (l = self->priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel *tp = l->data;
+
+      if (!tp || !tp->n_shows)
+        continue;
+
+      g_string_append_printf (str, "%s %u %u %.1f %.1f %.1f\n",
+                              tp->name, tp->n_shows, tp->n_cold_shows,
+                              tp->first_show_latency * 1000.0,
+                              tp->last_show_latency * 1000.0,
+                              tp->total_show_latency * 1000.0 / tp->n_shows);
+    }
+
+  *latency = g_string_free (str, FALSE);
+
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_panel_usage (MnbToolbar  *self,
+                                  gchar      **usage,
+                                  GError     **error)
+{
+  MnbToolbarPrivate *priv = self->priv;
+  GString           *str;
+  GList             *l;
+  gdouble            now;
+  guint              saved_kb = 0;
+
+  str = g_string_new ("# panel state idle-s unloads rss-kb\n");
+  now = g_timer_elapsed (priv->startup_timer, NULL);
+
+  for (l = priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel *tp = l->data;
+      const gchar     *state;
+
+      if (!tp || tp->windowless || !tp->service)
+        continue;
+
+      if (tp->panel)
+        state = "running";
+      else if (tp->idle_unloaded)
+        state = "unloaded";
+      else
+        state = "not-started";
+
+      if (tp->idle_unloaded)
+        saved_kb += tp->rss_kb;
+
+      g_string_append_printf (str, "%s %s %.0f %u %u\n",
+                              tp->name, state,
+                              tp->last_used > 0.0 ? now - tp->last_used : -1.0,
+                              tp->n_idle_unloads, tp->rss_kb);
+    }
+
+  g_string_append_printf (str, "saved-kb %u\n", saved_kb);
+
+  *usage = g_string_free (str, FALSE);
+
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_panel_health (MnbToolbar  *self,
+                                   gchar      **health,
+                                   GError     **error)
+{
+  GString *str;
+  GList   *l;
+
+  str = g_string_new ("# panel state pings replies missed last-ms max-ms "
+                      "mean-ms restarts quick-deaths\n");
+
+  for (l = self->priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel         *tp = l->data;
+      const MnbPanelOopHealth *h  = NULL;
+      const gchar             *state;
+
+      if (!tp || tp->windowless || !tp->service)
+        continue;
+
+      if (tp->panel && MNB_IS_PANEL_OOP (tp->panel))
+        h = mnb_panel_oop_get_health ((MnbPanelOop*)tp->panel);
+
+      if (tp->crash_loop)
+        state = "crash-loop";
+      else if (tp->restart_id)
+        state = "restarting";
+      else if (!tp->panel)
+        state = "not-running";
+      else if (tp->unresponsive)
+        state = "unresponsive";
+      else
+        state = "ok";
+
+      g_string_append_printf (str, "%s %s %u %u %u %.1f %.1f %.1f %u %u\n",
+                              tp->name, state,
+                              h ? h->n_pings : 0,
+                              h ? h->n_replies : 0,
+                              h ? h->n_missed : 0,
+                              h ? h->last_latency : 0.0,
+                              h ? h->max_latency : 0.0,
+                              h && h->n_replies ?
+                              h->total_latency / h->n_replies : 0.0,
+                              tp->n_restarts, tp->n_quick_deaths);
+    }
+
+  *health = g_string_free (str, FALSE);
+
+  return TRUE;
+}
+
+static gboolean
+mnb_toolbar_dbus_get_paint_profile (MnbToolbar  *self,
+                                    gboolean     reset,
+                                    gchar      **profile,
+                                    GError     **error)
+{
+  gchar   *frames;
+  guint    counts[MNB_BG_PAINT_LAST];
+
+  meego_netbook_get_background_paint_counts (counts);
+
+  frames = mnb_paint_profiler_dump (reset);
+
+  *profile = g_strdup_printf ("%s"
+                              "background-paint complete %u partial %u "
+                              "fallback %u skipped %u\n",
+                              frames,
+                              counts[MNB_BG_PAINT_COMPLETE],
+                              counts[MNB_BG_PAINT_PARTIAL],
+                              counts[MNB_BG_PAINT_FALLBACK],
+                              counts[MNB_BG_PAINT_SKIPPED]);
+  g_free (frames);
+
+  return TRUE;
+}
+
 #include "../src/mnb-toolbar-dbus-glue.h"
 
 static gboolean
@@ -825,6 +1277,7 @@ mnb_toolbar_class_init (MnbToolbarClass *klass)
   clutter_class->show = mnb_toolbar_real_show;
   clutter_class->hide = mnb_toolbar_real_hide;
   clutter_class->allocate = mnb_toolbar_allocate;
+  clutter_class->paint = mnb_toolbar_paint;
   clutter_class->button_press_event = mnb_toolbar_button_press_event;
 
   dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (klass),
@@ -975,6 +1428,8 @@ mnb_toolbar_panel_stub_timeout_cb (gpointer data)
       if (!tp || tp != stubbed)
         continue;
 
+      tp->show_requested = 0.0;
+
       if (mx_button_get_toggled (MX_BUTTON (tp->button)))
         {
           gchar *tooltip;
@@ -1020,6 +1475,8 @@ mnb_toolbar_show_pending_panel (MnbToolbar *toolbar, MnbToolbarPanel *tp)
   mnb_spinner_start ((MnbSpinner*)priv->spinner);
   priv->stubbed_panel = tp;
 
+  mnb_toolbar_panel_show_requested (toolbar, tp, TRUE);
+
   if (priv->panel_stub_timeout_id)
     {
       g_source_remove (priv->panel_stub_timeout_id);
@@ -1147,8 +1604,22 @@ mnb_toolbar_button_toggled_cb (MxButton *button,
 
         if (tp->panel)
           {
-            if (checked && !mnb_panel_is_mapped (tp->panel))
+            if (checked && !mnb_panel_is_mapped (tp->panel) &&
+                tp->unresponsive)
+              {
+                /*
+                 * Do not wait for a show the panel is not going to do; the
+                 * health monitor restores the button once the panel responds
+                 * again.
+                 */
+                g_warning ("Panel %s is not responding, not showing it",
+                           tp->name);
+
+                mx_button_set_toggled (MX_BUTTON (tp->button), FALSE);
+              }
+            else if (checked && !mnb_panel_is_mapped (tp->panel))
               {
+                mnb_toolbar_panel_show_requested (toolbar, tp, FALSE);
                 mnb_toolbar_set_waiting_for_panel_show (toolbar, TRUE, TRUE);
                 mnb_panel_show (tp->panel);
 
@@ -1328,12 +1799,18 @@ mnb_toolbar_panel_show_begin_cb (MnbPanel *panel, MnbToolbar *toolbar)
       wf = w;
       hf = h;
 
-      clutter_actor_animate (priv->panel_stub, CLUTTER_EASE_IN_SINE,
-                             SLIDE_DURATION,
-                             "opacity", 0,
-                             "width", wf,
-                             "height", hf,
-                             NULL);
+      if (meego_netbook_use_instant_mode (priv->plugin))
+        {
+          clutter_actor_set_opacity (priv->panel_stub, 0);
+          clutter_actor_set_size (priv->panel_stub, wf, hf);
+        }
+      else
+        clutter_actor_animate (priv->panel_stub, CLUTTER_EASE_IN_SINE,
+                               SLIDE_DURATION,
+                               "opacity", 0,
+                               "width", wf,
+                               "height", hf,
+                               NULL);
     }
 
   mnb_toolbar_raise_lowlight_for_panel (toolbar, panel);
@@ -1362,9 +1839,13 @@ mnb_toolbar_dropdown_show_completed_partial_cb (MnbPanel    *panel,
 {
   MnbToolbarPrivate *priv = toolbar->priv;
   MutterWindow      *mcw;
+  MnbToolbarPanel   *tp;
 
   g_assert (MNB_IS_PANEL_OOP (panel));
 
+  if ((tp = mnb_toolbar_panel_to_toolbar_panel (toolbar, panel)))
+    mnb_toolbar_panel_show_completed (toolbar, tp);
+
   mcw = mnb_panel_oop_get_mutter_window ((MnbPanelOop*)panel);
   mnb_panel_oop_set_delayed_show ((MnbPanelOop*)panel, FALSE);
 
@@ -1382,6 +1863,7 @@ mnb_toolbar_dropdown_show_completed_partial_cb (MnbPanel    *panel,
 
   mnb_toolbar_raise_lowlight_for_panel (toolbar, panel);
   mnb_toolbar_set_waiting_for_panel_show (toolbar, FALSE, FALSE);
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 static void
@@ -1390,9 +1872,13 @@ mnb_toolbar_dropdown_hide_completed_cb (MnbPanel *panel, MnbToolbar  *toolbar)
   MnbToolbarPrivate *priv = toolbar->priv;
   MutterPlugin      *plugin = priv->plugin;
   MnbPanel          *active;
+  MnbToolbarPanel   *tp;
 
   meego_netbook_stash_window_focus (plugin, CurrentTime);
 
+  if ((tp = mnb_toolbar_panel_to_toolbar_panel (toolbar, panel)))
+    tp->last_used = g_timer_elapsed (priv->startup_timer, NULL);
+
   if (!priv->waiting_for_panel_show &&
       !meego_netbook_use_netbook_mode (priv->plugin) &&
       (!(active = mnb_toolbar_get_active_panel (toolbar)) ||
@@ -1403,6 +1889,7 @@ mnb_toolbar_dropdown_hide_completed_cb (MnbPanel *panel, MnbToolbar  *toolbar)
 
   priv->panel_input_only = FALSE;
   mnb_toolbar_set_waiting_for_panel_hide (toolbar, FALSE);
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 static gint
@@ -1566,6 +2053,8 @@ mnb_toolbar_panel_request_button_style_cb (MnbPanel    *panel,
     return;
 
   clutter_actor_set_name (CLUTTER_ACTOR (tp->button), style_id);
+
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 static void
@@ -1599,6 +2088,8 @@ mnb_toolbar_panel_notify_modal_cb (MnbPanel   *panel,
 {
   MnbToolbarPanel *tp;
 
+  mnb_toolbar_queue_state_update (toolbar);
+
   tp = mnb_toolbar_panel_to_toolbar_panel (toolbar, panel);
 
   if (!tp || !tp->panel || !mnb_panel_is_mapped (tp->panel))
@@ -1621,6 +2112,8 @@ mnb_toolbar_panel_request_tooltip_cb (MnbPanel    *panel,
 
   if (tp->button && tp->type != MNB_TOOLBAR_PANEL_CLOCK)
     mx_widget_set_tooltip_text (MX_WIDGET (tp->button), tooltip);
+
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 /*
@@ -1709,6 +2202,8 @@ mnb_toolbar_dispose_of_panel (MnbToolbar      *toolbar,
 
   tp->panel  = NULL;
 
+  mnb_toolbar_queue_state_update (toolbar);
+
   g_signal_handlers_disconnect_matched (panel,
                                         G_SIGNAL_MATCH_DATA,
                                         0, 0, NULL, NULL,
@@ -1764,6 +2259,57 @@ mnb_toolbar_update_dropdown_input_region (MnbToolbar  *toolbar,
 }
 #endif
 
+static gboolean
+mnb_toolbar_panel_restart_cb (gpointer data)
+{
+  MnbToolbarServiceData *sd = data;
+  MnbToolbarPanel       *tp;
+
+  tp = mnb_toolbar_panel_service_to_panel_internal (sd->toolbar, sd->service);
+
+  if (!tp)
+    return FALSE;
+
+  tp->restart_id = 0;
+
+  if (!tp->panel && !mnb_toolbar_is_panel_pending (sd->toolbar, sd->service))
+    {
+      tp->n_restarts++;
+      mnb_toolbar_handle_dbus_name (sd->toolbar, sd->service);
+    }
+
+  return FALSE;
+}
+
+/*
+ * Restarts a panel that died; the first restart after the panel had been up
+ * for a while is immediate, subsequent ones are delayed exponentially.
+ */
+static void
+mnb_toolbar_schedule_panel_restart (MnbToolbar *toolbar, MnbToolbarPanel *tp)
+{
+  guint delay;
+
+  if (tp->restart_id)
+    return;
+
+  if (!tp->n_quick_deaths)
+    {
+      tp->n_restarts++;
+      mnb_toolbar_handle_dbus_name (toolbar, tp->service);
+      return;
+    }
+
+  delay = MIN (1 << (tp->n_quick_deaths - 1), TOOLBAR_PANEL_MAX_RESTART_DELAY);
+
+  tp->restart_id =
+    g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, delay,
+                                mnb_toolbar_panel_restart_cb,
+                                mnb_toolbar_service_data_new (toolbar,
+                                                              tp->service),
+                                mnb_toolbar_service_data_free);
+}
+
 static void
 mnb_toolbar_panel_died_cb (MnbPanel *panel, MnbToolbar *toolbar)
 {
@@ -1788,12 +2334,41 @@ mnb_toolbar_panel_died_cb (MnbPanel *panel, MnbToolbar *toolbar)
       return;
     }
 
+  /*
+   * If we unloaded the panel because it was not used, or it is an optional
+   * panel in lazy mode, leave it be; it gets started again when the user
+   * clicks on its button.
+   */
+  if (tp->idle_unloaded ||
+      (!tp->required &&
+       (meego_netbook_get_compositor_option_flags () & MNB_OPTION_LAZY_PANELS)))
+    {
+      return;
+    }
+
   /*
    * Try to restart the service
    */
   if (!toolbar->priv->no_autoloading && tp->service)
     {
-      mnb_toolbar_handle_dbus_name (toolbar, tp->service);
+      gdouble uptime = g_timer_elapsed (priv->startup_timer, NULL) -
+        tp->appeared;
+
+      if (uptime >= TOOLBAR_PANEL_HEALTHY_UPTIME)
+        tp->n_quick_deaths = 0;
+      else
+        tp->n_quick_deaths++;
+
+      if (tp->n_quick_deaths >= TOOLBAR_PANEL_MAX_QUICK_DEATHS)
+        {
+          g_warning ("Panel %s died %u times in a row shortly after starting, "
+                     "not restarting it", tp->name, tp->n_quick_deaths);
+
+          tp->crash_loop = TRUE;
+          return;
+        }
+
+      mnb_toolbar_schedule_panel_restart (toolbar, tp);
     }
 }
 
@@ -1814,6 +2389,8 @@ mnb_toolbar_panel_ready_cb (MnbPanel *panel, MnbToolbar *toolbar)
       if (!tp)
         return;
 
+      mnb_toolbar_queue_state_update (toolbar);
+
       button = tp->button;
 
       tooltip    = mnb_panel_get_tooltip (panel);
@@ -2213,6 +2790,11 @@ mnb_toolbar_append_panel (MnbToolbar  *toolbar, MnbPanel *panel)
         }
     }
 
+  if (service)
+    mnb_toolbar_trace_startup (toolbar, "%s ready%s", service,
+                               toolbar->priv->pending_panels ?
+                               "" : " (no panels pending)");
+
   /*
    * Make sure the failed flag is unset, in case a panel just took too long to
    * start.
@@ -2226,6 +2808,14 @@ mnb_toolbar_append_panel (MnbToolbar  *toolbar, MnbPanel *panel)
   if (panel == tp->panel)
     return;
 
+  tp->idle_unloaded = FALSE;
+  tp->crash_loop    = FALSE;
+  tp->unresponsive  = FALSE;
+  tp->last_used     = g_timer_elapsed (toolbar->priv->startup_timer, NULL);
+  tp->appeared      = tp->last_used;
+
+  mnb_toolbar_setup_health_monitor (toolbar);
+
   /*
    * Disconnect this function from the "ready" signal. Instead, we connect a
    * handler later on that updates things if this signal is issued again.
@@ -2269,6 +2859,8 @@ mnb_toolbar_append_panel (MnbToolbar  *toolbar, MnbPanel *panel)
 
   tp->panel = panel;
 
+  mnb_toolbar_queue_state_update (toolbar);
+
   if (tp->button)
     mnb_panel_set_button (panel, MX_BUTTON (tp->button));
 
@@ -2289,6 +2881,9 @@ mnb_toolbar_init (MnbToolbar *self)
 
   if (flags & MNB_OPTION_DISABLE_PANEL_RESTART)
     priv->no_autoloading = TRUE;
+
+  priv->startup_timer = g_timer_new ();
+  priv->startup_trace = g_string_new (NULL);
 }
 
 static DBusGConnection *
@@ -2359,6 +2954,8 @@ mnb_toolbar_handle_dbus_name (MnbToolbar *toolbar, const gchar *name)
   MnbToolbarPrivate *priv = toolbar->priv;
   MnbPanelOop       *panel;
 
+  mnb_toolbar_trace_startup (toolbar, "%s appeared", name);
+
   panel = mnb_panel_oop_new (name,
                              TOOLBAR_X_PADDING,
                              TOOLBAR_HEIGHT + 4,
@@ -2385,16 +2982,33 @@ mnb_toolbar_handle_dbus_name (MnbToolbar *toolbar, const gchar *name)
     }
 }
 
-static void
+/*
+ * Whether a panel object for the given service has already been created and
+ * we are waiting for it to become ready.
+ */
+static gboolean
+mnb_toolbar_is_panel_pending (MnbToolbar *toolbar, const gchar *name)
+{
+  GSList *l;
+
+  for (l = toolbar->priv->pending_panels; l; l = l->next)
+    {
+      const gchar *my_name = l->data;
+
+      if (!strcmp (my_name, name))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
 mnb_toolbar_noc_cb (DBusGProxy  *proxy,
                     const gchar *name,
                     const gchar *old_owner,
                     const gchar *new_owner,
                     MnbToolbar  *toolbar)
 {
-  MnbToolbarPrivate *priv;
-  GSList            *l;
-
   /*
    * Unfortunately, we get this for all name owner changes on the bus, so
    * return early.
@@ -2403,30 +3017,32 @@ mnb_toolbar_noc_cb (DBusGProxy  *proxy,
                         strlen (MPL_PANEL_DBUS_NAME_PREFIX)))
     return;
 
-  priv = MNB_TOOLBAR (toolbar)->priv;
+  if (old_owner && *old_owner)
+    {
+      MnbToolbarPanel *tp;
+
+      /*
+       * Let the panel know, so it can tell whether its process has died.
+       */
+      tp = mnb_toolbar_panel_service_to_panel_internal (toolbar, name);
+
+      if (tp && tp->panel && MNB_IS_PANEL_OOP (tp->panel))
+        mnb_panel_oop_name_owner_changed ((MnbPanelOop*)tp->panel,
+                                          old_owner, new_owner);
+    }
 
   if (!new_owner || !*new_owner)
     {
       /*
-       * This is the case where a panel gone away; we can ignore it here,
-       * as this gets handled nicely elsewhere.
+       * This is the case where a panel gone away; the panel has dealt with
+       * that above.
        */
       return;
     }
 
-  l = priv->pending_panels;
-  while (l)
-    {
-      const gchar *my_name = l->data;
-
-      if (!strcmp (my_name, name))
-        {
-          /* We are already handling this one */
-          return;
-        }
-
-      l = l->next;
-    }
+  /* We might be already handling this one */
+  if (mnb_toolbar_is_panel_pending (toolbar, name))
+    return;
 
   mnb_toolbar_handle_dbus_name (toolbar, name);
 }
@@ -2455,6 +3071,524 @@ mnb_toolbar_start_panel_service (MnbToolbar *toolbar, MnbToolbarPanel *tp)
   return TRUE;
 }
 
+/*
+ * Pre-warming of panels (enabled with the prewarm-panels compositor option).
+ *
+ * Once the initial panel discovery is done, we start the services for all the
+ * panels on the Toolbar that are not running yet, one at a time, from a low
+ * priority timeout, so that this happens when the compositor is otherwise
+ * idle. The panels are then picked up via NameOwnerChanged as usual, and go
+ * through the InitPanel handshake before the user ever clicks on them, so the
+ * first show takes the same path as any subsequent one.
+ */
+static gboolean
+mnb_toolbar_prewarm_panels_cb (gpointer data)
+{
+  MnbToolbar        *toolbar = MNB_TOOLBAR (data);
+  MnbToolbarPrivate *priv    = toolbar->priv;
+  guint32            flags   = meego_netbook_get_compositor_option_flags ();
+  GList             *l;
+
+  /*
+   * Make sure we have the final screen size, so the panel is initialized with
+   * the size it will be shown at.
+   */
+  mnb_toolbar_ensure_size_for_screen (toolbar);
+
+  for (l = priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel *tp = l->data;
+
+      if (!tp || tp->panel || tp->prewarmed || tp->windowless ||
+          tp->unloaded || tp->failed || !tp->service)
+        continue;
+
+      if (!tp->current && !tp->required)
+        continue;
+
+      /*
+       * In lazy mode, only the required panels are kept running.
+       */
+      if (!tp->required && (flags & MNB_OPTION_LAZY_PANELS))
+        continue;
+
+      tp->prewarmed = TRUE;
+
+      if (mnb_toolbar_is_panel_pending (toolbar, tp->service))
+        continue;
+
+      mnb_toolbar_trace_startup (toolbar, "%s pre-warm", tp->service);
+      mnb_toolbar_start_panel_service (toolbar, tp);
+
+      return TRUE;
+    }
+
+  mnb_toolbar_trace_startup (toolbar, "pre-warm done");
+
+  priv->prewarm_id = 0;
+  return FALSE;
+}
+
+static void
+mnb_toolbar_prewarm_panels (MnbToolbar *toolbar)
+{
+  MnbToolbarPrivate *priv  = toolbar->priv;
+  guint32            flags = meego_netbook_get_compositor_option_flags ();
+
+  if (!(flags & MNB_OPTION_PREWARM_PANELS) || priv->prewarm_id)
+    return;
+
+  priv->prewarm_id =
+    g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                TOOLBAR_PREWARM_INTERVAL,
+                                mnb_toolbar_prewarm_panels_cb,
+                                toolbar, NULL);
+}
+
+/*
+ * Panel health monitor.
+ *
+ * Every TOOLBAR_HEALTH_CHECK_INTERVAL we ping the panels that are worth
+ * watching: those the user is waiting for or looking at, those that have
+ * (re)started less than TOOLBAR_PANEL_HEALTHY_UPTIME ago, and those already
+ * known to be unresponsive. A panel that has not answered the previous ping
+ * by the time of the next one is flagged as unresponsive, and its button
+ * tooltip says so, until it replies again. Idle panels are left alone, so
+ * they do not get woken up for nothing, and the timeout is removed when
+ * there is nothing to watch.
+ */
+static void
+mnb_toolbar_panel_set_unresponsive (MnbToolbarPanel *tp, gboolean unresponsive)
+{
+  if (tp->unresponsive == unresponsive)
+    return;
+
+  tp->unresponsive = unresponsive;
+
+  if (!tp->button || tp->type == MNB_TOOLBAR_PANEL_CLOCK)
+    return;
+
+  if (unresponsive)
+    {
+      gchar *tooltip;
+
+      g_warning ("Panel %s is not responding", tp->name);
+
+      tooltip = g_strdup_printf (_("Sorry, %s is not responding"),
+                                 tp->tooltip ? tp->tooltip : tp->name);
+      mx_widget_set_tooltip_text (MX_WIDGET (tp->button), tooltip);
+      g_free (tooltip);
+    }
+  else
+    {
+      const gchar *tooltip = NULL;
+
+      if (tp->panel)
+        tooltip = mnb_panel_get_tooltip (tp->panel);
+
+      mx_widget_set_tooltip_text (MX_WIDGET (tp->button),
+                                  tooltip ? tooltip : tp->tooltip);
+    }
+}
+
+static gboolean
+mnb_toolbar_panel_needs_health_check (MnbToolbar      *toolbar,
+                                      MnbToolbarPanel *tp,
+                                      gdouble          now)
+{
+  if (!tp || !tp->panel || !MNB_IS_PANEL_OOP (tp->panel))
+    return FALSE;
+
+  return (tp->show_requested > 0.0 ||
+          tp->unresponsive ||
+          now - tp->appeared < TOOLBAR_PANEL_HEALTHY_UPTIME ||
+          mnb_panel_is_mapped (tp->panel));
+}
+
+static gboolean
+mnb_toolbar_health_check_cb (gpointer data)
+{
+  MnbToolbar        *toolbar = MNB_TOOLBAR (data);
+  MnbToolbarPrivate *priv    = toolbar->priv;
+  gdouble            now     = g_timer_elapsed (priv->startup_timer, NULL);
+  gboolean           watched = FALSE;
+  GList             *l;
+
+  for (l = priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel   *tp = l->data;
+      MnbPanelOop       *panel;
+
+      if (!mnb_toolbar_panel_needs_health_check (toolbar, tp, now))
+        continue;
+
+      panel = (MnbPanelOop*)tp->panel;
+
+      mnb_panel_oop_ping (panel);
+
+      mnb_toolbar_panel_set_unresponsive (tp,
+                              mnb_panel_oop_get_health (panel)->unresponsive);
+
+      watched = TRUE;
+    }
+
+  mnb_toolbar_queue_state_update (toolbar);
+
+  if (!watched)
+    {
+      priv->health_id = 0;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+mnb_toolbar_setup_health_monitor (MnbToolbar *toolbar)
+{
+  MnbToolbarPrivate *priv = toolbar->priv;
+
+  if (priv->health_id)
+    return;
+
+  priv->health_id =
+    g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                TOOLBAR_HEALTH_CHECK_INTERVAL,
+                                mnb_toolbar_health_check_cb,
+                                toolbar, NULL);
+}
+
+/*
+ * Lazy panels (enabled with the lazy-panels compositor option).
+ *
+ * Optional panels are not restarted when they go away, but only started when
+ * the user clicks on their button; panels that have not been used for
+ * TOOLBAR_IDLE_UNLOAD_TIMEOUT are told to unload. Required panels are never
+ * unloaded.
+ *
+ * Before unloading a panel, we note the RSS of its process, so we can report
+ * how much memory the policy is saving.
+ */
+static guint
+mnb_toolbar_get_process_rss (guint pid)
+{
+  gchar *path;
+  gchar *contents = NULL;
+  guint  rss_kb = 0;
+
+  path = g_strdup_printf ("/proc/%u/statm", pid);
+
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+    {
+      gulong size, resident;
+
+      if (sscanf (contents, "%lu %lu", &size, &resident) == 2)
+        rss_kb = resident * (sysconf (_SC_PAGESIZE) / 1024);
+    }
+
+  g_free (contents);
+  g_free (path);
+
+  return rss_kb;
+}
+
+static void
+mnb_toolbar_idle_unload_pid_cb (DBusGProxy *proxy,
+                                guint       pid,
+                                GError     *error,
+                                gpointer    data)
+{
+  MnbToolbarServiceData *ud      = data;
+  MnbToolbar           *toolbar = ud->toolbar;
+  const gchar          *service = ud->service;
+  MnbToolbarPanel      *tp;
+
+  toolbar->priv->pid_calls = g_list_remove (toolbar->priv->pid_calls, ud);
+
+  /*
+   * Look the panel up again, it might have been removed in the meantime.
+   */
+  tp = mnb_toolbar_panel_service_to_panel_internal (toolbar, service);
+
+  if (error)
+    {
+      g_warning ("Could not get pid of %s: %s", service, error->message);
+      g_error_free (error);
+    }
+  else if (tp)
+    tp->rss_kb = mnb_toolbar_get_process_rss (pid);
+
+  /*
+   * Make sure the panel was not used while we were waiting for the pid.
+   */
+  if (tp && tp->panel && tp->idle_unloaded && MNB_IS_PANEL_OOP (tp->panel) &&
+      !mnb_panel_is_mapped (tp->panel))
+    {
+      mnb_toolbar_trace_startup (toolbar, "%s idle unload (%u kB)",
+                                 service, tp->rss_kb);
+      tp->n_idle_unloads++;
+      mnb_panel_oop_unload ((MnbPanelOop*)tp->panel);
+    }
+  else if (tp)
+    tp->idle_unloaded = FALSE;
+
+  mnb_toolbar_service_data_free (ud);
+}
+
+static gboolean
+mnb_toolbar_idle_unload_cb (gpointer data)
+{
+  MnbToolbar        *toolbar = MNB_TOOLBAR (data);
+  MnbToolbarPrivate *priv    = toolbar->priv;
+  gdouble            now     = g_timer_elapsed (priv->startup_timer, NULL);
+  GList             *l;
+
+  if (!priv->dbus_proxy)
+    return TRUE;
+
+  for (l = priv->panels; l; l = l->next)
+    {
+      MnbToolbarPanel      *tp = l->data;
+      MnbToolbarServiceData *ud;
+
+      if (!tp || tp->required || !tp->panel || !tp->service ||
+          tp->idle_unloaded || tp->pinged || !MNB_IS_PANEL_OOP (tp->panel))
+        continue;
+
+      if (mnb_panel_is_mapped (tp->panel) ||
+          now - tp->last_used < TOOLBAR_IDLE_UNLOAD_TIMEOUT)
+        continue;
+
+      tp->idle_unloaded = TRUE;
+
+      ud = mnb_toolbar_service_data_new (toolbar, tp->service);
+
+      ud->call =
+        org_freedesktop_DBus_get_connection_unix_process_id_async (
+                                              priv->dbus_proxy,
+                                              tp->service,
+                                              mnb_toolbar_idle_unload_pid_cb,
+                                              ud);
+
+      priv->pid_calls = g_list_prepend (priv->pid_calls, ud);
+    }
+
+  return TRUE;
+}
+
+static void
+mnb_toolbar_setup_idle_unload (MnbToolbar *toolbar)
+{
+  MnbToolbarPrivate *priv  = toolbar->priv;
+  guint32            flags = meego_netbook_get_compositor_option_flags ();
+
+  if (!(flags & MNB_OPTION_LAZY_PANELS) || priv->idle_unload_id)
+    return;
+
+  priv->idle_unload_id =
+    g_timeout_add_seconds_full (G_PRIORITY_LOW,
+                                TOOLBAR_IDLE_UNLOAD_CHECK,
+                                mnb_toolbar_idle_unload_cb,
+                                toolbar, NULL);
+}
+
+/*
+ * Toolbar state snapshot.
+ *
+ * The panel list, the active panel, and the panel geometry are published in a
+ * shared memory segment (see mpl-toolbar-state.h in libmeego-panel), so that
+ * clients can read them without a round trip to us. Changes are collected in
+ * an idle callback, and the segment is only written to if the state actually
+ * changed.
+ */
+static void
+mnb_toolbar_fill_state (MnbToolbar *toolbar, MplToolbarStateSnapshot *snapshot)
+{
+  MnbToolbarPrivate *priv = toolbar->priv;
+  GList             *l;
+  guint              n = 0;
+
+  memset (snapshot, 0, sizeof (MplToolbarStateSnapshot));
+
+  snapshot->flags        = MPL_TOOLBAR_STATE_RUNNING;
+  snapshot->active_panel = -1;
+
+  if (CLUTTER_ACTOR_IS_MAPPED (toolbar))
+    snapshot->flags |= MPL_TOOLBAR_STATE_VISIBLE;
+
+  for (l = priv->panels; l && n < MPL_TOOLBAR_STATE_MAX_PANELS; l = l->next)
+    {
+      MnbToolbarPanel      *tp = l->data;
+      MplToolbarStatePanel *sp;
+      const gchar          *tooltip = NULL;
+      const gchar          *style   = NULL;
+
+      if (!tp || !tp->name)
+        continue;
+
+      sp = &snapshot->panels[n];
+
+      g_strlcpy (sp->name, tp->name, sizeof (sp->name));
+
+      if (tp->panel)
+        tooltip = mnb_panel_get_tooltip (tp->panel);
+
+      if (!tooltip)
+        tooltip = tp->tooltip;
+
+      if (tooltip)
+        g_strlcpy (sp->tooltip, tooltip, sizeof (sp->tooltip));
+
+      if (tp->button)
+        style = clutter_actor_get_name (CLUTTER_ACTOR (tp->button));
+
+      if (!style)
+        style = tp->button_style;
+
+      if (style)
+        g_strlcpy (sp->button_style, style, sizeof (sp->button_style));
+
+      if (tp->windowless)
+        sp->flags |= MPL_TOOLBAR_PANEL_STATE_WINDOWLESS;
+
+      if (tp->unresponsive)
+        sp->flags |= MPL_TOOLBAR_PANEL_STATE_UNRESPONSIVE;
+
+      if (tp->panel)
+        {
+          sp->flags |= MPL_TOOLBAR_PANEL_STATE_LOADED;
+
+          if (!tp->windowless)
+            {
+              gint  x, y;
+              guint w, h;
+
+              mnb_panel_get_position (tp->panel, &x, &y);
+              mnb_panel_get_size (tp->panel, &w, &h);
+
+              sp->x      = x;
+              sp->y      = y;
+              sp->width  = w;
+              sp->height = h;
+            }
+
+          if (mnb_panel_is_mapped (tp->panel))
+            {
+              sp->flags |= MPL_TOOLBAR_PANEL_STATE_VISIBLE;
+
+              if (snapshot->active_panel < 0)
+                snapshot->active_panel = n;
+            }
+
+          if (mnb_panel_is_modal (tp->panel))
+            sp->flags |= MPL_TOOLBAR_PANEL_STATE_MODAL;
+        }
+
+      n++;
+    }
+
+  snapshot->n_panels = n;
+}
+
+static gboolean
+mnb_toolbar_state_update_cb (gpointer data)
+{
+  MnbToolbar              *toolbar = MNB_TOOLBAR (data);
+  MnbToolbarPrivate       *priv    = toolbar->priv;
+  MplToolbarStateSnapshot  snapshot;
+
+  priv->state_update_id = 0;
+
+  mnb_toolbar_fill_state (toolbar, &snapshot);
+  mnb_toolbar_write_state (priv->state, &snapshot);
+
+  return FALSE;
+}
+
+static void
+mnb_toolbar_queue_state_update (MnbToolbar *toolbar)
+{
+  MnbToolbarPrivate *priv = toolbar->priv;
+
+  if (!priv->state || priv->state_update_id)
+    return;
+
+  priv->state_update_id = g_idle_add (mnb_toolbar_state_update_cb, toolbar);
+}
+
+static void
+mnb_toolbar_setup_state (MnbToolbar *toolbar)
+{
+  MnbToolbarPrivate      *priv = toolbar->priv;
+  MplToolbarStateSegment *segment;
+  gchar                  *name;
+  gint                    fd;
+  struct stat             st;
+
+  name = g_strdup_printf ("%s-%u", MPL_TOOLBAR_STATE_SHM_NAME, getuid ());
+
+  /*
+   * NB: the segment is never unlinked; should we get restarted, clients that
+   * have it mapped get to see the state of the new Toolbar.
+   */
+  if ((fd = shm_open (name, O_RDWR | O_CREAT, 0600)) < 0)
+    {
+      g_warning ("Could not open %s: %s", name, g_strerror (errno));
+      g_free (name);
+      return;
+    }
+
+  /*
+   * The name is predictable, so the segment might have been created by
+   * someone else; only use it if it is private to us.
+   */
+  if (fstat (fd, &st) < 0 ||
+      st.st_uid != getuid () ||
+      (st.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)) != (S_IRUSR | S_IWUSR))
+    {
+      g_warning ("Not using %s, as it is not owned by us or has wrong mode",
+                 name);
+      close (fd);
+      g_free (name);
+      return;
+    }
+
+  if (ftruncate (fd, sizeof (MplToolbarStateSegment)) < 0 ||
+      (segment = mmap (NULL, sizeof (MplToolbarStateSegment),
+                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd, 0)) == MAP_FAILED)
+    {
+      g_warning ("Could not map %s: %s", name, g_strerror (errno));
+      close (fd);
+      g_free (name);
+      return;
+    }
+
+  close (fd);
+  g_free (name);
+
+  if (segment->magic   != MPL_TOOLBAR_STATE_MAGIC ||
+      segment->version != MPL_TOOLBAR_STATE_VERSION)
+    {
+      memset (segment, 0, sizeof (MplToolbarStateSegment));
+
+      segment->version = MPL_TOOLBAR_STATE_VERSION;
+      segment->size    = sizeof (MplToolbarStateSegment);
+      segment->magic   = MPL_TOOLBAR_STATE_MAGIC;
+    }
+  else if (segment->sequence & 1)
+    {
+      /*
+       * Previous instance died in the middle of an update.
+       */
+      g_atomic_int_inc (&segment->sequence);
+    }
+
+  priv->state = segment;
+
+  mnb_toolbar_queue_state_update (toolbar);
+}
+
 #if 0
 static gboolean
 mnb_toolbar_autostart_panels_cb (gpointer toolbar)
@@ -2502,6 +3636,7 @@ mnb_toolbar_dbus_list_names_cb (DBusGProxy  *proxy,
 {
   MnbToolbar         *toolbar = MNB_TOOLBAR (data);
   MnbToolbarPrivate  *priv    = toolbar->priv;
+  guint               n_panels = 0;
 
   if (!priv->dbus_conn || !priv->dbus_proxy)
     {
@@ -2511,31 +3646,33 @@ mnb_toolbar_dbus_list_names_cb (DBusGProxy  *proxy,
 
   /*
    * Insert panels for any services already running.
+   *
+   * ListNames only returns names that currently have an owner, so there is
+   * no need to query the owner of each of the names (this used to be done
+   * with a blocking call per panel).
    */
   if (!error)
     {
-      gchar **p = names;
-      while (*p)
+      gchar **p;
+
+      for (p = names; *p; p++)
         {
-          if (!strncmp (*p, MPL_PANEL_DBUS_NAME_PREFIX,
-                        strlen (MPL_PANEL_DBUS_NAME_PREFIX)))
-            {
-              gboolean  has_owner = FALSE;
+          MnbToolbarPanel *tp;
 
-              if (org_freedesktop_DBus_name_has_owner (priv->dbus_proxy,
-                                                       *p, &has_owner, NULL) &&
-                  has_owner)
-                {
-                  MnbToolbarPanel *tp;
+          if (strncmp (*p, MPL_PANEL_DBUS_NAME_PREFIX,
+                       strlen (MPL_PANEL_DBUS_NAME_PREFIX)))
+            continue;
 
-                  tp = mnb_toolbar_panel_service_to_panel_internal (toolbar,*p);
+          n_panels++;
 
-                  if (tp)
-                    mnb_toolbar_handle_dbus_name (toolbar, *p);
-                }
-            }
+          tp = mnb_toolbar_panel_service_to_panel_internal (toolbar, *p);
 
-          p++;
+          /*
+           * The NameOwnerChanged handler is already in place, so the panel
+           * might have been picked up by that in the meantime.
+           */
+          if (tp && !tp->panel && !mnb_toolbar_is_panel_pending (toolbar, *p))
+            mnb_toolbar_handle_dbus_name (toolbar, *p);
         }
     }
   else
@@ -2545,12 +3682,14 @@ mnb_toolbar_dbus_list_names_cb (DBusGProxy  *proxy,
       g_error_free (error);
     }
 
+  mnb_toolbar_trace_startup (toolbar, "ListNames returned %u panels", n_panels);
+
   if (names)
     dbus_free_string_array (names);
 
-  dbus_g_proxy_connect_signal (priv->dbus_proxy, "NameOwnerChanged",
-                               G_CALLBACK (mnb_toolbar_noc_cb),
-                               toolbar, NULL);
+  mnb_toolbar_prewarm_panels (toolbar);
+  mnb_toolbar_setup_idle_unload (toolbar);
+  mnb_toolbar_setup_health_monitor (toolbar);
 }
 
 
@@ -2568,6 +3707,16 @@ mnb_toolbar_dbus_setup_panels (MnbToolbar *toolbar)
       return;
     }
 
+  /*
+   * Connect to NameOwnerChanged before listing the names, so that we do not
+   * miss any panels that start up between the two.
+   */
+  dbus_g_proxy_connect_signal (priv->dbus_proxy, "NameOwnerChanged",
+                               G_CALLBACK (mnb_toolbar_noc_cb),
+                               toolbar, NULL);
+
+  mnb_toolbar_trace_startup (toolbar, "ListNames sent");
+
   /*
    * Insert panels for any services already running. Like everything else,
    * do this asynchronously to avoid blocking the WM.
@@ -2810,6 +3959,7 @@ mnb_toolbar_constructed (GObject *self)
                     self);
 
   mnb_toolbar_setup_panels (MNB_TOOLBAR (self));
+  mnb_toolbar_setup_state (MNB_TOOLBAR (self));
 
   g_signal_connect (screen, "restacked",
                     G_CALLBACK (mnb_toolbar_screen_restacked_cb),
@@ -2856,6 +4006,7 @@ mnb_toolbar_activate_panel_internal (MnbToolbar        *toolbar,
             }
           else
             {
+              mnb_toolbar_panel_show_requested (toolbar, t, FALSE);
               mnb_toolbar_set_waiting_for_panel_show (toolbar, TRUE, TRUE);
               mnb_panel_show (t->panel);
             }
@@ -3367,10 +4518,16 @@ mnb_toolbar_ensure_size_for_screen (MnbToolbar *toolbar)
      * The panel size is the overall size of the panel actor; the height of the
      * actor includes the shadow, so we need to add the extra bit by which the
      * shadow protrudes below the actor.
+     *
+     * Position and size go together, so that the panel gets reconfigured
+     * only once per screen change.
      */
-    mnb_panel_set_size (tp->panel,
-                        screen_width - TOOLBAR_X_PADDING * 2,
-                        screen_height - TOOLBAR_HEIGHT - 8 - TOOLBAR_X_PADDING);
+    mnb_panel_set_geometry (tp->panel,
+                            TOOLBAR_X_PADDING,
+                            TOOLBAR_HEIGHT + 4,
+                            screen_width - TOOLBAR_X_PADDING * 2,
+                            screen_height - TOOLBAR_HEIGHT - 8 -
+                            TOOLBAR_X_PADDING);
   }
 
   if (priv->input_region)
@@ -3388,6 +4545,8 @@ mnb_toolbar_ensure_size_for_screen (MnbToolbar *toolbar)
 
   priv->old_screen_width  = screen_width;
   priv->old_screen_height = screen_height;
+
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 static void
@@ -3974,6 +5133,8 @@ mnb_toolbar_fixup_panels (MnbToolbar *toolbar, GSList *order, gboolean strings)
 
       mnb_toolbar_ensure_button_position (toolbar, tp);
     }
+
+  mnb_toolbar_queue_state_update (toolbar);
 }
 
 static void
@@ -27,6 +27,7 @@
 
 #include "../meego-netbook.h"
 #include "../mnb-input-manager.h"
+#include "../mnb-paint-profiler.h"
 #include "ntf-overlay.h"
 #include "ntf-libnotify.h"
 #include "ntf-wm.h"
@@ -163,7 +164,7 @@ enum
 /* static guint signals[N_SIGNALS] = {0}; */
 
 static void
-ntf_overlay_paint (ClutterActor *actor)
+ntf_overlay_paint_children (ClutterActor *actor)
 {
   NtfOverlayPrivate *priv = NTF_OVERLAY (actor)->priv;
 
@@ -177,12 +178,22 @@ ntf_overlay_paint (ClutterActor *actor)
     clutter_actor_paint (CLUTTER_ACTOR(priv->tray_urgent));
 }
 
+static void
+ntf_overlay_paint (ClutterActor *actor)
+{
+  gint64 start = mnb_paint_profiler_begin ();
+
+  ntf_overlay_paint_children (actor);
+
+  mnb_paint_profiler_end (MNB_PAINT_STAGE_NOTIFICATIONS, start);
+}
+
 static void
 ntf_overlay_pick (ClutterActor *actor, const ClutterColor *color)
 {
   CLUTTER_ACTOR_CLASS (ntf_overlay_parent_class)->pick (actor, color);
 
-  ntf_overlay_paint (actor);
+  ntf_overlay_paint_children (actor);
 }
 
 static void
@@ -26,9 +26,9 @@
 #endif
 
 #include <string.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
 
 #include "../meego-netbook.h"
+#include "../mnb-icon-cache.h"
 
 #include "ntf-source.h"
 
@@ -171,61 +171,40 @@ ntf_source_icon_changed_cb (MetaWindow *window,
                             GParamSpec *pspec,
                             NtfSource  *src)
 {
-  NtfSourcePrivate *priv   = src->priv;
-  GdkPixbuf        *pixbuf = NULL;
+  NtfSourcePrivate *priv    = src->priv;
+  CoglHandle        texture;
 
-  g_object_get (priv->window, "icon", &pixbuf, NULL);
+  if (!priv->icon)
+    return;
+
+  texture = mnb_icon_cache_get_texture (window);
 
-  if (!pixbuf && priv->icon)
+  if (texture == COGL_INVALID_HANDLE)
     {
       clutter_actor_destroy (priv->icon);
       priv->icon = NULL;
     }
-  else if (pixbuf && priv->icon)
-    {
-      clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (priv->icon),
-                                         gdk_pixbuf_get_pixels (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf),
-                                         gdk_pixbuf_get_width (pixbuf),
-                                         gdk_pixbuf_get_height (pixbuf),
-                                         gdk_pixbuf_get_rowstride (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf) ? 4 : 3,
-                                         0, NULL);
-    }
+  else
+    clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (priv->icon), texture);
 }
 
 static ClutterActor *
 ntf_source_get_icon_real (NtfSource *self)
 {
-  NtfSourcePrivate *priv   = self->priv;
-  GdkPixbuf        *pixbuf = NULL;
+  NtfSourcePrivate *priv = self->priv;
+  ClutterActor     *icon;
 
   if (!priv->window)
     return NULL;
 
-  g_object_get (priv->window, "icon", &pixbuf, NULL);
-
-  if (pixbuf)
+  if ((icon = mnb_icon_cache_get_icon (priv->window)))
     {
-      ClutterActor *icon = clutter_texture_new ();
-
-      clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (icon),
-                                         gdk_pixbuf_get_pixels (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf),
-                                         gdk_pixbuf_get_width (pixbuf),
-                                         gdk_pixbuf_get_height (pixbuf),
-                                         gdk_pixbuf_get_rowstride (pixbuf),
-                                         gdk_pixbuf_get_has_alpha (pixbuf) ? 4 : 3,
-                                         0, NULL);
-
-      g_signal_connect (priv->window, "notify::icon",
-                        G_CALLBACK (ntf_source_icon_changed_cb),
-                        self);
-
-      return icon;
+      g_signal_connect_object (priv->window, "notify::icon",
+                               G_CALLBACK (ntf_source_icon_changed_cb),
+                               self, 0);
     }
 
-  return NULL;
+  return icon;
 }
 
 static void